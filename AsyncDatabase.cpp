@@ -0,0 +1,263 @@
+#include "AsyncDatabase.h"
+#include "Trace.h"
+
+#include <QCoreApplication>
+
+namespace {
+
+// Сколько раз при закрытии повторяется неудавшееся сохранение изменений задач
+const int ExitSaveAttempts = 3;
+
+} // namespace
+
+AsyncDatabase::AsyncDatabase(int readerCount, QObject *parent)
+    : QObject(parent)
+{
+    // Соединение привязано к потоку, поэтому потоки пулов не должны завершаться
+    m_writerPool.setMaxThreadCount(1);
+    m_writerPool.setExpiryTimeout(-1);
+    m_readerPool.setMaxThreadCount(qMax(1, readerCount));
+    m_readerPool.setExpiryTimeout(-1);
+
+    m_saveTimer.setSingleShot(true);
+    connect(&m_saveTimer, &QTimer::timeout, this, [this]() {
+        flushTaskChanges();
+    });
+    if (QCoreApplication::instance()) {
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, [this]() {
+            flushTaskChanges();
+        });
+    }
+}
+
+AsyncDatabase::~AsyncDatabase()
+{
+    // Чтение, ждущее подтверждения порции, иначе не завершится
+    {
+        QMutexLocker locker(&m_streamsMutex);
+        for (const auto &stream : std::as_const(m_streams))
+            stream->cancelled.storeRelaxed(1);
+    }
+
+    // Накопленное сохраняется до остановки пула. Итоги отправок приходят
+    // очередью событий, которую цикл событий после выхода уже не разбирает:
+    // здесь они доставляются сразу, и неудавшееся отправляется ещё раз
+    m_closing = true;
+    for (int attempt = 0; attempt < ExitSaveAttempts; ++attempt) {
+        flushTaskChanges();
+        m_lastFlush.waitForFinished();
+        QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+        if (!hasPendingTaskChanges())
+            break;
+    }
+    if (hasPendingTaskChanges())
+        qWarning() << "Failed to save task changes on exit:" << m_pendingUpdates.size() << "updated,"
+                   << m_pendingRemovals.size() << "removed";
+    m_writerPool.waitForDone();
+    m_readerPool.waitForDone();
+}
+
+QFuture<bool> AsyncDatabase::open(const QString &path,
+                                  const std::function<void(DatabaseManager &)> &init,
+                                  const DatabasePragmas &pragmas)
+{
+    m_path = path;
+    m_pragmas = pragmas;
+    m_opened = QtConcurrent::run(&m_writerPool, [this, init]() {
+        DatabaseManager &db = writerConnection();
+        if (!db.database().isOpen() || !db.createTables())
+            return false;
+        if (init)
+            init(db);
+        return true;
+    });
+    return m_opened;
+}
+
+DatabaseManager &AsyncDatabase::writerConnection()
+{
+    if (!m_writer.hasLocalData()) {
+        DatabaseManager *db = new DatabaseManager;
+        db->openDatabase(m_path, m_pragmas, "kurstodo-writer");
+        m_writer.setLocalData(db);
+    }
+    return *m_writer.localData();
+}
+
+DatabaseManager &AsyncDatabase::readerConnection()
+{
+    if (!m_readers.hasLocalData()) {
+        DatabaseManager *db = new DatabaseManager;
+        db->openDatabase(m_path, m_pragmas,
+                         "kurstodo-reader-" + QString::number(m_readerSerial.fetchAndAddRelaxed(1)));
+        m_readers.setLocalData(db);
+    }
+    return *m_readers.localData();
+}
+
+int AsyncDatabase::streamTasks(int batchSize, int window)
+{
+    const int requestId = m_streamSerial.fetchAndAddRelaxed(1) + 1;
+    auto stream = std::make_shared<TaskStream>(batchSize, qMax(1, window));
+    {
+        QMutexLocker locker(&m_streamsMutex);
+        m_streams.insert(requestId, stream);
+    }
+
+    read([this, requestId, stream](DatabaseManager &db) {
+        int total = 0;
+        {
+            QSqlQuery count("SELECT COUNT(*) FROM Tasks", db.database());
+            if (count.next())
+                total = count.value(0).toInt();
+        }
+        emit taskStreamStarted(requestId, total);
+        readTaskBatches(requestId, stream, db);
+    });
+    return requestId;
+}
+
+void AsyncDatabase::readTaskBatches(int requestId, const std::shared_ptr<TaskStream> &stream, DatabaseManager &db)
+{
+    TaskCursor cursor(db.database(), stream->batchSize, stream->position);
+    for (;;) {
+        {
+            QMutexLocker locker(&m_streamsMutex);
+            if (stream->cancelled.loadRelaxed() || cursor.atEnd()) {
+                m_streams.remove(requestId);
+                return;
+            }
+            // Получатель ещё не разобрал прежние порции, и очередь событий
+            // GUI-потока не заполняется всем набором: поток возвращается в пул
+            if (stream->credits == 0) {
+                stream->position = cursor.position();
+                stream->running = false;
+                return;
+            }
+            --stream->credits;
+        }
+        const QVector<Task> batch = cursor.fetchNext();
+        emit taskBatchReady(requestId, batch, cursor.atEnd());
+    }
+}
+
+void AsyncDatabase::releaseTaskBatch(int requestId)
+{
+    std::shared_ptr<TaskStream> stream;
+    {
+        QMutexLocker locker(&m_streamsMutex);
+        stream = m_streams.value(requestId);
+        if (!stream)
+            return;
+        ++stream->credits;
+        if (stream->running)
+            return;
+        stream->running = true;
+    }
+    // Остановленное чтение продолжается новой задачей пула
+    QtConcurrent::run(&m_readerPool, [this, requestId, stream]() {
+        readTaskBatches(requestId, stream, readerConnection());
+    });
+}
+
+void AsyncDatabase::cancelTaskStream(int requestId)
+{
+    QMutexLocker locker(&m_streamsMutex);
+    auto it = m_streams.find(requestId);
+    if (it == m_streams.end())
+        return;
+    it.value()->cancelled.storeRelaxed(1);
+    // Остановленное чтение задачи в пуле не имеет, его убирает отмена
+    if (!it.value()->running)
+        m_streams.erase(it);
+}
+
+void AsyncDatabase::scheduleTaskUpdate(const Task &task)
+{
+    m_pendingUpdates.insert(task.id, task);
+    startSaveTimer();
+}
+
+void AsyncDatabase::scheduleTaskRemoval(qint64 id)
+{
+    m_pendingUpdates.remove(id);
+    m_pendingRemovals.insert(id);
+    startSaveTimer();
+}
+
+void AsyncDatabase::startSaveTimer()
+{
+    if (!m_pendingSince.isValid())
+        m_pendingSince.start();
+    const qint64 remaining = qMax<qint64>(0, m_maxSaveLatencyMs - m_pendingSince.elapsed());
+    m_saveTimer.start(int(qMin<qint64>(m_saveDelayMs, remaining)));
+}
+
+QFuture<bool> AsyncDatabase::flushTaskChanges()
+{
+    m_saveTimer.stop();
+    m_pendingSince.invalidate();
+    if (!hasPendingTaskChanges())
+        return QtFuture::makeReadyValueFuture(true);
+
+    TRACE_SCOPE("sql", "flushTaskChanges");
+    const QVector<Task> updated = m_pendingUpdates.values();
+    const QVector<qint64> removed(m_pendingRemovals.cbegin(), m_pendingRemovals.cend());
+    m_pendingUpdates.clear();
+    m_pendingRemovals.clear();
+
+    const quint64 serial = ++m_flushSerial;
+    for (const Task &task : updated)
+        m_flushedIn.insert(task.id, serial);
+    for (qint64 id : removed)
+        m_flushedIn.insert(id, serial);
+
+    // Итог возвращается в GUI-поток очередью событий: будущее остаётся без
+    // продолжения, его можно ждать и из потока чтения
+    m_lastFlush = QtConcurrent::run(&m_writerPool, [this, serial, updated, removed]() {
+        const bool ok = writerConnection().saveTaskChanges(updated, removed);
+        if (!ok) {
+            qWarning() << "Failed to save task changes:" << updated.size() << "updated," << removed.size() << "removed";
+            m_unsavedTaskChanges.storeRelease(1);
+        }
+        QMetaObject::invokeMethod(this, [this, serial, updated, removed, ok]() {
+            finishTaskFlush(serial, updated, removed, ok);
+        }, Qt::QueuedConnection);
+        return ok;
+    });
+    return m_lastFlush;
+}
+
+void AsyncDatabase::finishTaskFlush(quint64 serial, const QVector<Task> &updated,
+                                    const QVector<qint64> &removed, bool ok)
+{
+    // Задача, попавшая в более позднюю отправку или снова ждущая её,
+    // уже вытеснена; остальные при ошибке возвращаются в очередь
+    auto settle = [this, serial](qint64 id) {
+        auto it = m_flushedIn.find(id);
+        if (it == m_flushedIn.end() || it.value() != serial)
+            return false;
+        m_flushedIn.erase(it);
+        return !m_pendingUpdates.contains(id) && !m_pendingRemovals.contains(id);
+    };
+    bool requeued = false;
+    for (const Task &task : updated) {
+        if (settle(task.id) && !ok) {
+            m_pendingUpdates.insert(task.id, task);
+            requeued = true;
+        }
+    }
+    for (qint64 id : removed) {
+        if (settle(id) && !ok) {
+            m_pendingRemovals.insert(id);
+            requeued = true;
+        }
+    }
+    if (requeued && !m_closing)
+        startSaveTimer();
+    // Всё отправленное сохранено, когда не осталось ни отправок в пути, ни очереди
+    if (ok && m_flushedIn.isEmpty() && !hasPendingTaskChanges())
+        m_unsavedTaskChanges.storeRelease(0);
+    if (!m_closing)
+        emit taskChangesSaved(ok);
+}
@@ -0,0 +1,151 @@
+#ifndef ASYNCDATABASE_H
+#define ASYNCDATABASE_H
+
+#include <QObject>
+#include <QFuture>
+#include <QThreadPool>
+#include <QThreadStorage>
+#include <QtConcurrent>
+#include <QAtomicInt>
+#include <QThread>
+#include <QMutex>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <memory>
+#include <functional>
+#include <type_traits>
+#include "DatabaseManager.h"
+#include "TaskCursor.h"
+
+// Асинхронный доступ к базе: GUI-поток не выполняет SQL.
+// Запись идёт через единственный поток писателя со своим соединением,
+// чтение - через небольшой пул потоков, у каждого своё соединение
+// (в режиме WAL читатели не ждут писателя). Результаты возвращаются QFuture,
+// продолжения удобно вешать через QFuture::then(context, ...).
+class AsyncDatabase : public QObject
+{
+    Q_OBJECT
+public:
+    explicit AsyncDatabase(int readerCount = 2, QObject *parent = nullptr);
+    ~AsyncDatabase();
+
+    // Открывает базу на потоке писателя, создаёт таблицы и выполняет init.
+    // Чтения, поставленные раньше, ждут завершения открытия.
+    QFuture<bool> open(const QString &path,
+                       const std::function<void(DatabaseManager &)> &init = {},
+                       const DatabasePragmas &pragmas = DatabasePragmas());
+
+    // Отложенные изменения задач уходят писателю раньше новой записи,
+    // поэтому запись видит их так же, как если бы они были сохранены сразу
+    template <typename Fn>
+    auto write(Fn fn) -> QFuture<std::invoke_result_t<Fn, DatabaseManager &>>
+    {
+        if (hasPendingTaskChanges() && QThread::currentThread() == thread())
+            flushTaskChanges();
+        return QtConcurrent::run(&m_writerPool, [this, fn]() mutable {
+            return fn(writerConnection());
+        });
+    }
+
+    // Чтение из GUI-потока тоже видит отложенные изменения: они уходят
+    // писателю, и поток чтения ждёт их транзакцию перед запросом
+    template <typename Fn>
+    auto read(Fn fn) -> QFuture<std::invoke_result_t<Fn, DatabaseManager &>>
+    {
+        QFuture<bool> flushed;
+        if (QThread::currentThread() == thread()) {
+            if (hasPendingTaskChanges())
+                flushTaskChanges();
+            flushed = m_lastFlush;
+        }
+        return QtConcurrent::run(&m_readerPool, [this, fn, flushed]() mutable {
+            m_opened.waitForFinished();
+            flushed.waitForFinished();
+            return fn(readerConnection());
+        });
+    }
+
+    // Читает все задачи порциями на потоке чтения: сначала taskStreamStarted
+    // с общим числом задач, затем порции сигналом taskBatchReady.
+    // Вперёд читается не больше window порций: получатель подтверждает
+    // каждую обработанную порцию вызовом releaseTaskBatch. Поток чтения
+    // получателя не ждёт: без подтверждений чтение останавливается, и
+    // подтверждение ставит в пул следующее.
+    // Возвращает номер запроса.
+    int streamTasks(int batchSize, int window = 2);
+    void releaseTaskBatch(int requestId);
+    void cancelTaskStream(int requestId);
+
+    // Отложенное сохранение задач (только из GUI-потока): изменения копятся,
+    // пока идут правки, и уходят писателю одной транзакцией через saveDelay
+    // после последней, но не позже maxSaveLatency после первой.
+    // Для каждой задачи сохраняется последняя версия; накопленное
+    // отправляется и при выходе из приложения. Неудавшаяся транзакция
+    // (например, SQLITE_BUSY, пока запись держит kurstodo-cli) возвращает
+    // в очередь изменения, которые не вытеснены более новыми, и повторяется.
+    void scheduleTaskUpdate(const Task &task);
+    void scheduleTaskRemoval(qint64 id);
+    QFuture<bool> flushTaskChanges();
+    bool hasPendingTaskChanges() const { return !m_pendingUpdates.isEmpty() || !m_pendingRemovals.isEmpty(); }
+    // Ни одна отправка не провалилась без успешного повтора, т.е. база
+    // содержит всё отправленное; можно вызывать из любого потока
+    bool taskChangesSettled() const { return !m_unsavedTaskChanges.loadAcquire(); }
+    void setSaveDelay(int ms, int maxLatencyMs) { m_saveDelayMs = ms; m_maxSaveLatencyMs = maxLatencyMs; }
+
+signals:
+    void taskStreamStarted(int requestId, int total);
+    void taskBatchReady(int requestId, const QVector<Task> &batch, bool last);
+    // Итог очередной отправки отложенных изменений задач
+    void taskChangesSaved(bool ok);
+
+private:
+    DatabaseManager &writerConnection();
+    DatabaseManager &readerConnection();
+
+    QString m_path;
+    DatabasePragmas m_pragmas;
+    QFuture<bool> m_opened;
+    QAtomicInt m_readerSerial;
+    QAtomicInt m_streamSerial;
+
+    // credits и running - под m_streamsMutex; position меняет только
+    // задача пула, читающая порции (running), и передаёт следующей через мьютекс
+    struct TaskStream {
+        TaskStream(int batchSize, int window) : batchSize(batchSize), credits(window) {}
+        int batchSize;
+        int credits;
+        bool running = true;
+        TaskCursor::Position position;
+        QAtomicInt cancelled;
+    };
+    void readTaskBatches(int requestId, const std::shared_ptr<TaskStream> &stream, DatabaseManager &db);
+    void startSaveTimer();
+    void finishTaskFlush(quint64 serial, const QVector<Task> &updated, const QVector<qint64> &removed, bool ok);
+    QMutex m_streamsMutex;
+    QHash<int, std::shared_ptr<TaskStream>> m_streams;
+
+    QTimer m_saveTimer;
+    QElapsedTimer m_pendingSince;
+    QHash<qint64, Task> m_pendingUpdates;
+    QSet<qint64> m_pendingRemovals;
+    // Номер последней отправки, содержащей задачу, пока она не завершилась:
+    // результат старой отправки не возвращает в очередь вытесненную версию
+    QHash<qint64, quint64> m_flushedIn;
+    quint64 m_flushSerial = 0;
+    QFuture<bool> m_lastFlush;
+    QAtomicInt m_unsavedTaskChanges;
+    bool m_closing = false;     // деструктор сам повторяет неудавшиеся отправки
+    int m_saveDelayMs = 300;
+    int m_maxSaveLatencyMs = 2000;
+
+    // Хранилища объявлены раньше пулов: потоки пулов завершаются первыми
+    // и удаляют свои соединения, пока хранилища ещё живы
+    QThreadStorage<DatabaseManager *> m_writer;
+    QThreadStorage<DatabaseManager *> m_readers;
+    QThreadPool m_writerPool;
+    QThreadPool m_readerPool;
+};
+
+#endif // ASYNCDATABASE_H
@@ -0,0 +1,112 @@
+#include "CalendarAggregates.h"
+
+CalendarAggregates::CalendarAggregates(AsyncDatabase *db, QObject *parent)
+    : QObject(parent), m_db(db)
+{
+}
+
+void CalendarAggregates::ensureMonths(const QDate &month, int radius)
+{
+    const QDate key = monthKey(month);
+    for (int offset = -radius; offset <= radius; ++offset) {
+        const QDate other = key.addMonths(offset);
+        const Month &entry = m_months[other];
+        if (!entry.loaded && !entry.loading)
+            load(other);
+    }
+}
+
+bool CalendarAggregates::isLoaded(const QDate &month) const
+{
+    return m_months.value(monthKey(month)).loaded;
+}
+
+DayCounts CalendarAggregates::counts(const QDate &day) const
+{
+    auto it = m_months.constFind(monthKey(day));
+    if (it == m_months.constEnd())
+        return DayCounts();
+    return it->days.value(day);
+}
+
+void CalendarAggregates::reload()
+{
+    const QList<QDate> months = m_months.keys();
+    for (const QDate &month : months) {
+        Month &entry = m_months[month];
+        if (entry.loading)
+            entry.stale = true;
+        else if (entry.loaded)
+            load(month);
+    }
+}
+
+void CalendarAggregates::load(const QDate &month)
+{
+    m_months[month].loading = true;
+
+    // Чтение идёт через поток писателя: так оно видит все изменения,
+    // поставленные в очередь раньше, и кэш не расходится с базой
+    m_db->write([month](DatabaseManager &m) {
+        return m.countByDay(month);
+    }).then(this, [this, month](const QMap<QDate, DayCounts> &days) {
+        Month &entry = m_months[month];
+        if (entry.stale) {
+            entry.stale = false;
+            load(month);
+            return;
+        }
+        entry.days = days;
+        entry.loaded = true;
+        entry.loading = false;
+        emit monthChanged(month);
+    });
+}
+
+void CalendarAggregates::apply(const Task &task, int delta)
+{
+    if (!task.date.isValid())
+        return;
+
+    // Повторения серии могут попасть в любой месяц: дешевле перечитать окно
+    if (task.isRecurring()) {
+        reload();
+        return;
+    }
+
+    const QDate key = monthKey(task.date);
+    auto it = m_months.find(key);
+    if (it == m_months.end())
+        return;
+    if (it->loading) {
+        it->stale = true;
+        return;
+    }
+    if (!it->loaded)
+        return;
+
+    DayCounts &day = it->days[task.date];
+    (task.completed ? day.done : day.open) += delta;
+    if (day.total() <= 0)
+        it->days.remove(task.date);
+    emit monthChanged(key);
+}
+
+void CalendarAggregates::taskAdded(const Task &task)
+{
+    apply(task, 1);
+}
+
+void CalendarAggregates::taskRemoved(const Task &task)
+{
+    apply(task, -1);
+}
+
+void CalendarAggregates::taskUpdated(const Task &before, const Task &after)
+{
+    if (before.date == after.date && before.completed == after.completed
+        && before.recurrence == after.recurrence)
+        return;
+    apply(before, -1);
+    apply(after, 1);
+}
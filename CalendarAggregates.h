@@ -0,0 +1,51 @@
+#ifndef CALENDARAGGREGATES_H
+#define CALENDARAGGREGATES_H
+
+#include <QObject>
+#include <QHash>
+#include <QMap>
+#include <QDate>
+#include "AsyncDatabase.h"
+
+// Кэш числа задач по дням для окна месяцев вокруг показанного.
+// Месяц читается из базы один раз (диапазон по индексу Tasks(date)),
+// дальше изменения задач применяются к кэшу как разности; изменение
+// повторяющейся задачи перечитывает загруженные месяцы целиком.
+class CalendarAggregates : public QObject
+{
+    Q_OBJECT
+public:
+    explicit CalendarAggregates(AsyncDatabase *db, QObject *parent = nullptr);
+
+    // Загружает month и radius месяцев по обе стороны от него
+    void ensureMonths(const QDate &month, int radius = 1);
+    bool isLoaded(const QDate &month) const;
+    DayCounts counts(const QDate &day) const;
+    // Перечитывает загруженные месяцы (изменились повторения)
+    void reload();
+
+    void taskAdded(const Task &task);
+    void taskRemoved(const Task &task);
+    void taskUpdated(const Task &before, const Task &after);
+
+signals:
+    // Числа за месяц изменились (month - первое число месяца)
+    void monthChanged(const QDate &month);
+
+private:
+    struct Month {
+        QMap<QDate, DayCounts> days;
+        bool loaded = false;
+        bool loading = false;
+        bool stale = false;     // изменение пришло во время чтения
+    };
+
+    static QDate monthKey(const QDate &date) { return QDate(date.year(), date.month(), 1); }
+    void load(const QDate &month);
+    void apply(const Task &task, int delta);
+
+    AsyncDatabase *m_db;
+    QHash<QDate, Month> m_months;
+};
+
+#endif // CALENDARAGGREGATES_H
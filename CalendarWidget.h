@@ -6,21 +6,162 @@
 #include <QVBoxLayout>
 #include <QLabel>
 #include <QCalendarWidget>
+#include <QListWidget>
+#include <QMenu>
+#include <QPainter>
+#include "AsyncDatabase.h"
+#include "CalendarAggregates.h"
+#include "Theme.h"
+
+// Календарь-тепловая карта: чем больше задач в день, тем ярче ячейка;
+// дни с просроченными задачами подсвечены красным
+class HeatmapCalendar : public QCalendarWidget {
+    Q_OBJECT
+public:
+    HeatmapCalendar(CalendarAggregates *aggregates, QWidget *parent = nullptr)
+        : QCalendarWidget(parent), aggregates(aggregates) {}
+
+protected:
+    void paintCell(QPainter *painter, const QRect &rect, QDate date) const override {
+        QCalendarWidget::paintCell(painter, rect, date);
+
+        const DayCounts day = aggregates->counts(date);
+        if (day.total() == 0)
+            return;
+
+        const bool overdue = day.open > 0 && date < QDate::currentDate();
+        // Насыщенность растёт с числом задач и упирается в потолок на 8
+        const int alpha = 40 + qMin(day.total(), 8) * 20;
+        QColor color = Theme::instance()->color(overdue ? Theme::Danger : Theme::Accent);
+        color.setAlpha(alpha);
+
+        painter->save();
+        painter->fillRect(rect.adjusted(1, 1, -1, -1), color);
+
+        QFont font = painter->font();
+        font.setPixelSize(10);
+        painter->setFont(font);
+        painter->setPen(Theme::instance()->color(Theme::Text));
+        painter->drawText(rect.adjusted(2, 0, -3, -1), Qt::AlignRight | Qt::AlignBottom,
+                          QString("%1/%2").arg(day.done).arg(day.total()));
+        painter->restore();
+    }
+
+private:
+    CalendarAggregates *aggregates;
+};
 
 class CalendarWidget : public QWidget {
     Q_OBJECT
 public:
-    CalendarWidget(QWidget *parent = nullptr) {
+    CalendarWidget(AsyncDatabase *db, CalendarAggregates *aggregates, QWidget *parent = nullptr)
+        : QWidget(parent), db(db), aggregates(aggregates) {
         QVBoxLayout *layout = new QVBoxLayout;
         QLabel *title = new QLabel("📅 Календарь");
         title->setAlignment(Qt::AlignCenter);
 
-        QCalendarWidget *calendar = new QCalendarWidget;
+        calendar = new HeatmapCalendar(aggregates);
+
+        dayTitle = new QLabel;
+        dayTitle->setProperty("role", "sectionTitle");
+        dayTasks = new QListWidget;
+        dayTasks->setContextMenuPolicy(Qt::CustomContextMenu);
 
         layout->addWidget(title);
         layout->addWidget(calendar);
-        layout->addStretch();
+        layout->addWidget(dayTitle);
+        layout->addWidget(dayTasks);
         setLayout(layout);
+
+        // Соседние месяцы подгружаются заранее, листание берёт их из кэша
+        connect(calendar, &QCalendarWidget::currentPageChanged, this, [this](int year, int month) {
+            this->aggregates->ensureMonths(QDate(year, month, 1));
+        });
+        connect(calendar, &QCalendarWidget::selectionChanged, this, &CalendarWidget::loadDayTasks);
+        // Повторение отмечается здесь, сама серия правится в списке задач
+        connect(dayTasks, &QListWidget::itemDoubleClicked, this, [this](QListWidgetItem *item) {
+            if (item->data(RecurringRole).toBool())
+                markOccurrence(item, item->data(CompletedRole).toBool() ? DatabaseManager::OccurrenceOpen
+                                                                        : DatabaseManager::OccurrenceDone);
+        });
+        connect(dayTasks, &QWidget::customContextMenuRequested, this, &CalendarWidget::showOccurrenceMenu);
+        connect(aggregates, &CalendarAggregates::monthChanged, this, [this](const QDate &month) {
+            if (month.year() == calendar->yearShown() && month.month() == calendar->monthShown())
+                calendar->updateCells();
+            const QDate selected = calendar->selectedDate();
+            if (selected.year() == month.year() && selected.month() == month.month())
+                loadDayTasks();
+        });
+
+        aggregates->ensureMonths(calendar->selectedDate());
+        loadDayTasks();
+    }
+
+signals:
+    // Отметка повторения сохранена в базе
+    void occurrenceMarked(qint64 id, const QDate &day, DatabaseManager::OccurrenceState state);
+
+private:
+    AsyncDatabase *db;
+    CalendarAggregates *aggregates;
+    HeatmapCalendar *calendar;
+    QLabel *dayTitle;
+    QListWidget *dayTasks;
+    int dayRequest = 0;
+
+    enum ItemRoles { TaskIdRole = Qt::UserRole + 1, RecurringRole, CompletedRole };
+
+    void loadDayTasks() {
+        const QDate day = calendar->selectedDate();
+        dayTitle->setText(day.toString("dd.MM.yyyy"));
+
+        // Ответ на устаревший запрос (выбран другой день) отбрасывается
+        const int request = ++dayRequest;
+        db->write([day](DatabaseManager &m) {
+            return m.getTasksOnDay(day);
+        }).then(this, [this, request](const QVector<Task> &tasks) {
+            if (request != dayRequest)
+                return;
+            dayTasks->clear();
+            for (const Task &task : tasks) {
+                QString text = (task.completed ? "✅ " : "⬜ ") + task.text;
+                if (task.isRecurring())
+                    text += "  🔁";
+                QListWidgetItem *item = new QListWidgetItem(text, dayTasks);
+                item->setData(TaskIdRole, task.id);
+                item->setData(RecurringRole, task.isRecurring());
+                item->setData(CompletedRole, task.completed);
+            }
+        });
+    }
+
+    void showOccurrenceMenu(const QPoint &pos) {
+        QListWidgetItem *item = dayTasks->itemAt(pos);
+        if (!item || !item->data(RecurringRole).toBool())
+            return;
+
+        QMenu menu(this);
+        const bool done = item->data(CompletedRole).toBool();
+        QAction *toggle = menu.addAction(done ? "⬜ Не выполнено" : "✅ Выполнено");
+        QAction *skip = menu.addAction("⏭ Пропустить этот день");
+        QAction *chosen = menu.exec(dayTasks->viewport()->mapToGlobal(pos));
+        if (chosen == toggle)
+            markOccurrence(item, done ? DatabaseManager::OccurrenceOpen : DatabaseManager::OccurrenceDone);
+        else if (chosen == skip)
+            markOccurrence(item, DatabaseManager::OccurrenceSkipped);
+    }
+
+    void markOccurrence(QListWidgetItem *item, DatabaseManager::OccurrenceState state) {
+        const qint64 id = item->data(TaskIdRole).toLongLong();
+        const QDate day = calendar->selectedDate();
+        db->write([id, day, state](DatabaseManager &m) {
+            return m.setOccurrenceState(id, day, state);
+        }).then(this, [this, id, day, state](bool ok) {
+            if (!ok)
+                return;
+            aggregates->reload();
+            emit occurrenceMarked(id, day, state);
+        });
     }
 };
 
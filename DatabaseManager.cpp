@@ -1,4 +1,13 @@
 #include "DatabaseManager.h"
+#include "TaskJournal.h"
+#include "Trace.h"
+
+#include <QFile>
+#include <QUrl>
+#include <QCryptographicHash>
+#include <QMimeDatabase>
+#include <QRegularExpression>
+#include <algorithm>
 
 DatabaseManager::DatabaseManager(QObject *parent)
     : QObject(parent)
@@ -7,16 +16,30 @@ DatabaseManager::DatabaseManager(QObject *parent)
 
 DatabaseManager::~DatabaseManager()
 {
+    clearStatementCache();
+    const QString name = m_db.connectionName();
     if (m_db.isOpen())
         m_db.close();
+    if (m_ownsConnection) {
+        m_db = QSqlDatabase();
+        QSqlDatabase::removeDatabase(name);
+    }
 }
 
-bool DatabaseManager::openDatabase(const QString &path)
+bool DatabaseManager::openDatabase(const QString &path, const DatabasePragmas &pragmas,
+                                   const QString &connectionName)
 {
-    if (QSqlDatabase::contains("qt_sql_default_connection"))
-        m_db = QSqlDatabase::database("qt_sql_default_connection");
+    TRACE_SCOPE("sql", "openDatabase");
+    clearStatementCache();
+
+    const QString name = connectionName.isEmpty()
+                             ? QString::fromLatin1(QSqlDatabase::defaultConnection)
+                             : connectionName;
+    if (QSqlDatabase::contains(name))
+        m_db = QSqlDatabase::database(name);
     else
-        m_db = QSqlDatabase::addDatabase("QSQLITE");
+        m_db = QSqlDatabase::addDatabase("QSQLITE", name);
+    m_ownsConnection = !connectionName.isEmpty();
 
     m_db.setDatabaseName(path);
 
@@ -24,84 +47,1324 @@ bool DatabaseManager::openDatabase(const QString &path)
         qWarning() << "Failed to open database:" << m_db.lastError().text();
         return false;
     }
+    return applyPragmas(pragmas);
+}
+
+bool DatabaseManager::applyPragmas(const DatabasePragmas &pragmas)
+{
+    QSqlQuery query(m_db);
+    const QStringList statements = {
+        "PRAGMA journal_mode = " + pragmas.journalMode,
+        "PRAGMA synchronous = " + pragmas.synchronous,
+        // Отрицательное значение cache_size - размер в КиБ, а не в страницах
+        "PRAGMA cache_size = " + QString::number(-pragmas.cacheSizeKiB),
+        "PRAGMA mmap_size = " + QString::number(pragmas.mmapSize),
+        "PRAGMA busy_timeout = " + QString::number(pragmas.busyTimeoutMs)
+    };
+    for (const QString &sql : statements) {
+        if (!query.exec(sql)) {
+            qWarning() << "Failed to apply" << sql << ":" << query.lastError().text();
+            return false;
+        }
+    }
     return true;
 }
 
+QSqlQuery &DatabaseManager::cachedQuery(const QString &sql)
+{
+    QSqlQuery *query = m_statements.value(sql);
+    if (query)
+        return *query;
+
+    // Запрос с ошибкой подготовки живёт отдельно: вызывающий получает ссылку
+    // и видит ошибку, а следующий вызов пробует подготовить его снова
+    query = m_failedStatements.take(sql);
+    if (!query)
+        query = new QSqlQuery(m_db);
+    if (!query->prepare(sql)) {
+        qWarning() << "Failed to prepare statement:" << query->lastError().text() << sql;
+        m_failedStatements.insert(sql, query);
+        return *query;
+    }
+    m_statements.insert(sql, query);
+    return *query;
+}
+
+void DatabaseManager::clearStatementCache()
+{
+    qDeleteAll(m_statements);
+    m_statements.clear();
+    qDeleteAll(m_failedStatements);
+    m_failedStatements.clear();
+}
+
 bool DatabaseManager::createTables()
 {
-    QSqlQuery query;
+    TRACE_SCOPE("sql", "createTables");
+    QSqlQuery query(m_db);
 
+    // date - номер юлианского дня (QDate::toJulianDay), NULL - без срока
     bool res1 = query.exec("CREATE TABLE IF NOT EXISTS Tasks ("
                            "id INTEGER PRIMARY KEY AUTOINCREMENT, "
                            "text TEXT NOT NULL, "
-                           "date TEXT, "
-                           "tag TEXT)");
+                           "date INTEGER, "
+                           "tag TEXT, "
+                           "completed INTEGER NOT NULL DEFAULT 0)");
     if (!res1) {
         qWarning() << "Failed to create Tasks table:" << query.lastError().text();
         return false;
     }
 
+    // Базы, созданные до появления флага выполнения
+    if (!ensureColumn("Tasks", "completed", "INTEGER NOT NULL DEFAULT 0"))
+        return false;
+
+    // Базы, где дата хранилась строкой dd.MM.yyyy
+    if (!migrateDatesToJulianDay())
+        return false;
+
+    // rrule - правило повторения (Recurrence), NULL - задача не повторяется
+    if (!ensureColumn("Tasks", "rrule", "TEXT"))
+        return false;
+
+    if (!query.exec("CREATE INDEX IF NOT EXISTS idx_tasks_date ON Tasks(date)")
+        || !query.exec("CREATE INDEX IF NOT EXISTS idx_tasks_tag ON Tasks(tag)")) {
+        qWarning() << "Failed to create Tasks indexes:" << query.lastError().text();
+        return false;
+    }
+
+    // plain - текст заметки без HTML, по нему строится поисковый индекс
     bool res2 = query.exec("CREATE TABLE IF NOT EXISTS Notes ("
                            "id INTEGER PRIMARY KEY AUTOINCREMENT, "
-                           "text TEXT NOT NULL)");
+                           "text TEXT NOT NULL, "
+                           "plain TEXT NOT NULL DEFAULT '')");
     if (!res2) {
         qWarning() << "Failed to create Notes table:" << query.lastError().text();
         return false;
     }
 
+    if (!ensureColumn("Notes", "plain", "TEXT NOT NULL DEFAULT ''"))
+        return false;
+
+    if (!createBlobTable())
+        return false;
+
+    if (!createGenerationCounter())
+        return false;
+
+    if (!createNoteHistoryTable())
+        return false;
+
+    if (!createOccurrenceTable())
+        return false;
+
+    return createSearchIndex();
+}
+
+bool DatabaseManager::createGenerationCounter()
+{
+    QSqlQuery query(m_db);
+
+    // Счётчик растёт с каждой транзакцией, меняющей задачи (bumpTasksGeneration),
+    // в том числе из kurstodo-cli: по нему проверяется, что снимок задач на
+    // диске не устарел. Построчные триггеры прежних версий удаляются: лишний
+    // UPDATE на каждую строку замедлял пакетную вставку в полтора раза
+    const QStringList statements = {
+        "CREATE TABLE IF NOT EXISTS Meta (key TEXT PRIMARY KEY, value INTEGER NOT NULL)",
+        "INSERT OR IGNORE INTO Meta (key, value) VALUES ('tasks_generation', 0)",
+        "DROP TRIGGER IF EXISTS TasksGenerationInsert",
+        "DROP TRIGGER IF EXISTS TasksGenerationDelete",
+        "DROP TRIGGER IF EXISTS TasksGenerationUpdate"
+    };
+    for (const QString &sql : statements) {
+        if (!query.exec(sql)) {
+            qWarning() << "Failed to create generation counter:" << query.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DatabaseManager::createNoteHistoryTable()
+{
+    QSqlQuery query(m_db);
+
+    // flags - NoteHistory::Flag; size - длина HTML ревизии, data - полный текст
+    // или разность с предыдущей ревизией, возможно сжатые
+    bool res = query.exec("CREATE TABLE IF NOT EXISTS NoteRevisions ("
+                          "note_id INTEGER NOT NULL, "
+                          "revision INTEGER NOT NULL, "
+                          "flags INTEGER NOT NULL, "
+                          "created INTEGER NOT NULL, "
+                          "size INTEGER NOT NULL, "
+                          "data BLOB NOT NULL, "
+                          "PRIMARY KEY (note_id, revision)) WITHOUT ROWID");
+    if (!res) {
+        qWarning() << "Failed to create NoteRevisions table:" << query.lastError().text();
+        return false;
+    }
+
+    // Вложения, на которые ссылалась хоть одна ревизия: pruneBlobs их не удаляет,
+    // пока жива заметка (текст ревизий сжат, искать в нём нельзя)
+    res = query.exec("CREATE TABLE IF NOT EXISTS NoteBlobRefs ("
+                     "note_id INTEGER NOT NULL, "
+                     "blob_id INTEGER NOT NULL, "
+                     "PRIMARY KEY (note_id, blob_id)) WITHOUT ROWID");
+    if (!res || !query.exec("CREATE INDEX IF NOT EXISTS idx_noteblobrefs_blob ON NoteBlobRefs(blob_id)")) {
+        qWarning() << "Failed to create NoteBlobRefs table:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool DatabaseManager::recordBlobRefs(qint64 noteId, const QByteArray &html)
+{
+    static const QByteArray scheme = QByteArrayLiteral("blob:");
+    QSqlQuery &query = cachedQuery("INSERT OR IGNORE INTO NoteBlobRefs (note_id, blob_id) VALUES (:note, :blob)");
+    for (qsizetype pos = html.indexOf(scheme); pos >= 0; pos = html.indexOf(scheme, pos)) {
+        pos += scheme.size();
+        qint64 blobId = 0;
+        qsizetype end = pos;
+        while (end < html.size() && html.at(end) >= '0' && html.at(end) <= '9')
+            blobId = blobId * 10 + (html.at(end++) - '0');
+        if (end == pos)
+            continue;
+        query.bindValue(":note", noteId);
+        query.bindValue(":blob", blobId);
+        if (!query.exec()) {
+            qWarning() << "Failed to record blob reference:" << query.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DatabaseManager::createOccurrenceTable()
+{
+    QSqlQuery query(m_db);
+
+    // Повторения задач не хранятся; здесь только отметки отдельных повторений
+    // (выполнено/пропущено), day - номер юлианского дня
+    const QStringList statements = {
+        "CREATE TABLE IF NOT EXISTS TaskOccurrences ("
+        "task_id INTEGER NOT NULL, "
+        "day INTEGER NOT NULL, "
+        "state INTEGER NOT NULL, "
+        "PRIMARY KEY (task_id, day)) WITHOUT ROWID",
+        "CREATE INDEX IF NOT EXISTS idx_taskoccurrences_day ON TaskOccurrences(day)",
+        "CREATE INDEX IF NOT EXISTS idx_tasks_recurring ON Tasks(date) WHERE rrule IS NOT NULL",
+        "CREATE TRIGGER IF NOT EXISTS TaskOccurrencesCleanup AFTER DELETE ON Tasks BEGIN "
+        "DELETE FROM TaskOccurrences WHERE task_id = old.id; END",
+        "DROP TRIGGER IF EXISTS TaskOccurrencesGenerationInsert",
+        "DROP TRIGGER IF EXISTS TaskOccurrencesGenerationDelete",
+        "DROP TRIGGER IF EXISTS TaskOccurrencesGenerationUpdate"
+    };
+    for (const QString &sql : statements) {
+        if (!query.exec(sql)) {
+            qWarning() << "Failed to create TaskOccurrences table:" << query.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DatabaseManager::bumpTasksGeneration()
+{
+    QSqlQuery &query = cachedQuery("UPDATE Meta SET value = value + 1 WHERE key = 'tasks_generation'");
+    if (!query.exec()) {
+        qWarning() << "Failed to update tasks generation:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool DatabaseManager::execTaskWrite(QSqlQuery &query, const char *failure)
+{
+    if (!m_db.transaction()) {
+        qWarning() << "Failed to start transaction:" << m_db.lastError().text();
+        return false;
+    }
+    if (!query.exec()) {
+        qWarning() << failure << query.lastError().text();
+        m_db.rollback();
+        return false;
+    }
+    if (!bumpTasksGeneration()) {
+        m_db.rollback();
+        return false;
+    }
+    if (!m_db.commit()) {
+        qWarning() << "Failed to commit tasks:" << m_db.lastError().text();
+        m_db.rollback();
+        return false;
+    }
     return true;
 }
 
-bool DatabaseManager::addTask(const QString &text, const QString &date, const QString &tag)
+qint64 DatabaseManager::tasksGeneration()
+{
+    QSqlQuery &query = cachedQuery("SELECT value FROM Meta WHERE key = 'tasks_generation'");
+    if (!query.exec() || !query.next()) {
+        qWarning() << "Failed to read tasks generation:" << query.lastError().text();
+        return -1;
+    }
+    const qint64 generation = query.value(0).toLongLong();
+    query.finish();
+    return generation;
+}
+
+bool DatabaseManager::createBlobTable()
+{
+    QSqlQuery query(m_db);
+
+    bool existed = false;
+    if (query.exec("SELECT COUNT(*) FROM sqlite_master WHERE type = 'table' AND name = 'Blobs'") && query.next())
+        existed = query.value(0).toInt() == 1;
+    query.finish();
+
+    // hash - SHA-256 содержимого в hex, по нему одинаковые файлы сводятся в одну строку
+    bool res = query.exec("CREATE TABLE IF NOT EXISTS Blobs ("
+                          "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+                          "hash TEXT NOT NULL UNIQUE, "
+                          "mime TEXT, "
+                          "size INTEGER NOT NULL, "
+                          "data BLOB NOT NULL)");
+    if (!res) {
+        qWarning() << "Failed to create Blobs table:" << query.lastError().text();
+        return false;
+    }
+
+    // Заметки, созданные до появления таблицы, ссылаются на файлы по пути
+    return existed || migrateNoteImagesToBlobs();
+}
+
+bool DatabaseManager::migrateNoteImagesToBlobs()
 {
-    QSqlQuery query;
-    query.prepare("INSERT INTO Tasks (text, date, tag) VALUES (:text, :date, :tag)");
+    TRACE_SCOPE("sql", "migrateNoteImagesToBlobs");
+    QVector<QPair<qint64, QString>> notes;
+    QSqlQuery query(m_db);
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT id, text FROM Notes WHERE text LIKE '%<img%'")) {
+        qWarning() << "Failed to select notes with images:" << query.lastError().text();
+        return false;
+    }
+    while (query.next())
+        notes.append({query.value(0).toLongLong(), query.value(1).toString()});
+    query.finish();
+    if (notes.isEmpty())
+        return true;
+
+    static const QRegularExpression imageSource(
+        "<img\\b[^>]*\\bsrc\\s*=\\s*[\"']([^\"']+)[\"']", QRegularExpression::CaseInsensitiveOption);
+
+    if (!m_db.transaction()) {
+        qWarning() << "Failed to start migration:" << m_db.lastError().text();
+        return false;
+    }
+    for (auto &note : notes) {
+        QString html = note.second;
+        bool changed = false;
+
+        // С конца, чтобы замены не сдвигали позиции ещё не обработанных ссылок
+        QVector<QRegularExpressionMatch> matches;
+        auto it = imageSource.globalMatch(html);
+        while (it.hasNext())
+            matches.append(it.next());
+        for (auto m = matches.crbegin(); m != matches.crend(); ++m) {
+            const QString source = m->captured(1);
+            if (source.startsWith("blob:"))
+                continue;
+            const QUrl url(source);
+            QFile file(url.isLocalFile() ? url.toLocalFile() : source);
+            if (!file.open(QIODevice::ReadOnly))
+                continue;
+            const qint64 blobId = storeBlob(file.readAll());
+            if (blobId < 0)
+                continue;
+            html.replace(m->capturedStart(1), m->capturedLength(1), "blob:" + QString::number(blobId));
+            changed = true;
+        }
+
+        if (!changed)
+            continue;
+        QSqlQuery &update = cachedQuery("UPDATE Notes SET text = :text WHERE id = :id");
+        update.bindValue(":text", html);
+        update.bindValue(":id", note.first);
+        if (!update.exec()) {
+            qWarning() << "Failed to migrate note images:" << update.lastError().text();
+            m_db.rollback();
+            return false;
+        }
+    }
+    if (!m_db.commit()) {
+        qWarning() << "Failed to commit migration:" << m_db.lastError().text();
+        m_db.rollback();
+        return false;
+    }
+    return true;
+}
+
+bool DatabaseManager::createSearchIndex()
+{
+    TRACE_SCOPE("sql", "createSearchIndex");
+    QSqlQuery query(m_db);
+
+    // Таблицы FTS5 ссылаются на Tasks/Notes (external content) и не хранят
+    // копию текста; синхронизацию выполняют триггеры. prefix='2 3' хранит
+    // отдельные индексы коротких префиксов: поиск по мере ввода ищет "w"*,
+    // и без них одна-две буквы перебирают весь диапазон терминов
+    int existing = 0;
+    bool withPrefixes = true;
+    if (query.exec("SELECT sql FROM sqlite_master WHERE name IN ('TasksFts', 'NotesFts')")) {
+        while (query.next()) {
+            ++existing;
+            if (!query.value(0).toString().contains("prefix="))
+                withPrefixes = false;
+        }
+    }
+    query.finish();
+
+    // Индексы прежних версий без префиксов пересоздаются
+    if (existing > 0 && !withPrefixes) {
+        if (!query.exec("DROP TABLE IF EXISTS TasksFts") || !query.exec("DROP TABLE IF EXISTS NotesFts")) {
+            qWarning() << "Failed to drop search index:" << query.lastError().text();
+            return false;
+        }
+        existing = 0;
+    }
+    const bool existed = existing == 2;
+
+    const QStringList statements = {
+        "CREATE VIRTUAL TABLE IF NOT EXISTS TasksFts USING fts5("
+        "text, tag, content='Tasks', content_rowid='id', tokenize='unicode61 remove_diacritics 2', "
+        "prefix='2 3')",
+        "CREATE TRIGGER IF NOT EXISTS TasksFtsInsert AFTER INSERT ON Tasks BEGIN "
+        "INSERT INTO TasksFts(rowid, text, tag) VALUES (new.id, new.text, new.tag); END",
+        "CREATE TRIGGER IF NOT EXISTS TasksFtsDelete AFTER DELETE ON Tasks BEGIN "
+        "INSERT INTO TasksFts(TasksFts, rowid, text, tag) VALUES ('delete', old.id, old.text, old.tag); END",
+        "CREATE TRIGGER IF NOT EXISTS TasksFtsUpdate AFTER UPDATE OF text, tag ON Tasks BEGIN "
+        "INSERT INTO TasksFts(TasksFts, rowid, text, tag) VALUES ('delete', old.id, old.text, old.tag); "
+        "INSERT INTO TasksFts(rowid, text, tag) VALUES (new.id, new.text, new.tag); END",
+
+        "CREATE VIRTUAL TABLE IF NOT EXISTS NotesFts USING fts5("
+        "plain, content='Notes', content_rowid='id', tokenize='unicode61 remove_diacritics 2', "
+        "prefix='2 3')",
+        "CREATE TRIGGER IF NOT EXISTS NotesFtsInsert AFTER INSERT ON Notes BEGIN "
+        "INSERT INTO NotesFts(rowid, plain) VALUES (new.id, new.plain); END",
+        "CREATE TRIGGER IF NOT EXISTS NotesFtsDelete AFTER DELETE ON Notes BEGIN "
+        "INSERT INTO NotesFts(NotesFts, rowid, plain) VALUES ('delete', old.id, old.plain); END",
+        "CREATE TRIGGER IF NOT EXISTS NotesFtsUpdate AFTER UPDATE OF plain ON Notes BEGIN "
+        "INSERT INTO NotesFts(NotesFts, rowid, plain) VALUES ('delete', old.id, old.plain); "
+        "INSERT INTO NotesFts(rowid, plain) VALUES (new.id, new.plain); END"
+    };
+    for (const QString &sql : statements) {
+        if (!query.exec(sql)) {
+            qWarning() << "Failed to create search index:" << query.lastError().text();
+            return false;
+        }
+    }
+
+    // Индекс только что создан над уже заполненными таблицами
+    if (!existed) {
+        if (!query.exec("INSERT INTO TasksFts(TasksFts) VALUES ('rebuild')")
+            || !query.exec("INSERT INTO NotesFts(NotesFts) VALUES ('rebuild')")) {
+            qWarning() << "Failed to build search index:" << query.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DatabaseManager::ensureColumn(const QString &table, const QString &column, const QString &definition)
+{
+    QSqlQuery query(m_db);
+    if (!query.exec("PRAGMA table_info(" + table + ")")) {
+        qWarning() << "Failed to read table info:" << query.lastError().text();
+        return false;
+    }
+    while (query.next()) {
+        if (query.value("name").toString() == column)
+            return true;
+    }
+
+    if (!query.exec("ALTER TABLE " + table + " ADD COLUMN " + column + " " + definition)) {
+        qWarning() << "Failed to add column" << column << ":" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool DatabaseManager::migrateDatesToJulianDay()
+{
+    TRACE_SCOPE("sql", "migrateDatesToJulianDay");
+    QSqlQuery query(m_db);
+    if (!query.exec("PRAGMA table_info(Tasks)")) {
+        qWarning() << "Failed to read table info:" << query.lastError().text();
+        return false;
+    }
+    bool textDates = false;
+    while (query.next()) {
+        if (query.value("name").toString() == "date")
+            textDates = query.value("type").toString().compare("TEXT", Qt::CaseInsensitive) == 0;
+    }
+    query.finish();
+    if (!textDates)
+        return true;
+
+    // У столбца с типом TEXT числа снова станут строками, поэтому таблица
+    // пересобирается целиком в одной транзакции. julianday() даёт полночь (x.5),
+    // QDate считает день с полудня - отсюда +0.5.
+    const QStringList statements = {
+        "CREATE TABLE Tasks_migrated ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "text TEXT NOT NULL, "
+        "date INTEGER, "
+        "tag TEXT, "
+        "completed INTEGER NOT NULL DEFAULT 0)",
+        "INSERT INTO Tasks_migrated (id, text, date, tag, completed) "
+        "SELECT id, text, "
+        "CASE WHEN date GLOB '[0-9][0-9].[0-9][0-9].[0-9][0-9][0-9][0-9]' "
+        "THEN CAST(julianday(substr(date, 7, 4) || '-' || substr(date, 4, 2) || '-' || substr(date, 1, 2)) + 0.5 AS INTEGER) "
+        "ELSE NULL END, "
+        "tag, completed FROM Tasks",
+        "DROP TABLE Tasks",
+        "ALTER TABLE Tasks_migrated RENAME TO Tasks"
+    };
+
+    if (!m_db.transaction()) {
+        qWarning() << "Failed to start migration:" << m_db.lastError().text();
+        return false;
+    }
+    for (const QString &sql : statements) {
+        if (!query.exec(sql)) {
+            qWarning() << "Failed to migrate task dates:" << query.lastError().text();
+            m_db.rollback();
+            return false;
+        }
+    }
+    if (!m_db.commit()) {
+        qWarning() << "Failed to commit migration:" << m_db.lastError().text();
+        m_db.rollback();
+        return false;
+    }
+    return true;
+}
+
+QVariant DatabaseManager::dateValue(const QDate &date)
+{
+    return date.isValid() ? QVariant(date.toJulianDay()) : QVariant();
+}
+
+QVariant DatabaseManager::ruleValue(const QString &rule)
+{
+    return rule.isEmpty() ? QVariant(QMetaType::fromType<QString>()) : QVariant(rule);
+}
+
+Task DatabaseManager::taskFromQuery(const QSqlQuery &query)
+{
+    Task task;
+    task.id = query.value(0).toLongLong();
+    task.text = query.value(1).toString();
+    const QVariant date = query.value(2);
+    if (!date.isNull())
+        task.date = QDate::fromJulianDay(date.toLongLong());
+    task.tag = query.value(3).toString();
+    task.completed = query.value(4).toBool();
+    task.recurrence = query.value(5).toString();
+    return task;
+}
+
+qint64 DatabaseManager::addTask(const QString &text, const QDate &date, const QString &tag, bool completed,
+                                const QString &recurrence)
+{
+    TRACE_SCOPE("sql", "addTask");
+    QSqlQuery &query = cachedQuery("INSERT INTO Tasks (text, date, tag, completed, rrule) "
+                                   "VALUES (:text, :date, :tag, :completed, :rrule)");
+    query.bindValue(":text", text);
+    query.bindValue(":date", dateValue(date));
+    query.bindValue(":tag", tag);
+    query.bindValue(":completed", completed);
+    query.bindValue(":rrule", ruleValue(recurrence));
+    if (!execTaskWrite(query, "Failed to insert task:"))
+        return -1;
+    return query.lastInsertId().toLongLong();
+}
+
+bool DatabaseManager::updateTask(qint64 id, const QString &text, const QDate &date, const QString &tag)
+{
+    TRACE_SCOPE("sql", "updateTask");
+    QSqlQuery &query = cachedQuery("UPDATE Tasks SET text = :text, date = :date, tag = :tag WHERE id = :id");
     query.bindValue(":text", text);
-    query.bindValue(":date", date);
+    query.bindValue(":date", dateValue(date));
     query.bindValue(":tag", tag);
+    query.bindValue(":id", id);
+    return execTaskWrite(query, "Failed to update task:");
+}
+
+bool DatabaseManager::setTaskCompleted(qint64 id, bool completed)
+{
+    TRACE_SCOPE("sql", "setTaskCompleted");
+    QSqlQuery &query = cachedQuery("UPDATE Tasks SET completed = :completed WHERE id = :id");
+    query.bindValue(":completed", completed);
+    query.bindValue(":id", id);
+    return execTaskWrite(query, "Failed to update task state:");
+}
+
+bool DatabaseManager::deleteTask(qint64 id)
+{
+    TRACE_SCOPE("sql", "deleteTask");
+    QSqlQuery &query = cachedQuery("DELETE FROM Tasks WHERE id = :id");
+    query.bindValue(":id", id);
+    return execTaskWrite(query, "Failed to delete task:");
+}
+
+Task DatabaseManager::getTaskById(qint64 id)
+{
+    TRACE_SCOPE("sql", "getTaskById");
+    Task task;
+    QSqlQuery &query = cachedQuery("SELECT id, text, date, tag, completed, rrule FROM Tasks WHERE id = :id");
+    query.bindValue(":id", id);
+    if (!query.exec())
+        qWarning() << "Failed to select task:" << query.lastError().text();
+    else if (query.next())
+        task = taskFromQuery(query);
+    query.finish();
+    return task;
+}
+
+QVector<Task> DatabaseManager::getAllTasks()
+{
+    TRACE_SCOPE("sql", "getAllTasks");
+    QSqlQuery &query = cachedQuery("SELECT id, text, date, tag, completed, rrule FROM Tasks ORDER BY date, id");
+    return selectTasks(query, "Failed to select tasks:");
+}
+
+QVector<Task> DatabaseManager::getTasksInRange(const QDate &from, const QDate &to)
+{
+    TRACE_SCOPE("sql", "getTasksInRange");
+    QSqlQuery &query = cachedQuery("SELECT id, text, date, tag, completed, rrule FROM Tasks "
+                                   "WHERE date BETWEEN :from AND :to ORDER BY date, id");
+    query.bindValue(":from", from.toJulianDay());
+    query.bindValue(":to", to.toJulianDay());
+    return selectTasks(query, "Failed to select tasks in range:");
+}
+
+QVector<Task> DatabaseManager::getOverdue()
+{
+    TRACE_SCOPE("sql", "getOverdue");
+    QSqlQuery &query = cachedQuery("SELECT id, text, date, tag, completed, rrule FROM Tasks "
+                                   "WHERE date < :today AND completed = 0 AND rrule IS NULL ORDER BY date, id");
+    query.bindValue(":today", QDate::currentDate().toJulianDay());
+    return selectTasks(query, "Failed to select overdue tasks:");
+}
+
+QVector<Task> DatabaseManager::selectTasks(QSqlQuery &query, const char *failure)
+{
+    QVector<Task> tasks;
+    if (!query.exec()) {
+        qWarning() << failure << query.lastError().text();
+        return tasks;
+    }
+    while (query.next())
+        tasks.append(taskFromQuery(query));
+    query.finish();
+    return tasks;
+}
+
+QMap<QDate, DayCounts> DatabaseManager::countByDay(const QDate &month)
+{
+    TRACE_SCOPE("sql", "countByDay");
+    QMap<QDate, DayCounts> counts;
+    const QDate first(month.year(), month.month(), 1);
+
+    QSqlQuery &query = cachedQuery("SELECT date, COUNT(*) - SUM(completed), SUM(completed) FROM Tasks "
+                                   "WHERE date BETWEEN :from AND :to AND rrule IS NULL GROUP BY date");
+    query.bindValue(":from", first.toJulianDay());
+    query.bindValue(":to", first.addMonths(1).addDays(-1).toJulianDay());
+    if (!query.exec()) {
+        qWarning() << "Failed to count tasks by day:" << query.lastError().text();
+        return counts;
+    }
+    while (query.next()) {
+        DayCounts day;
+        day.open = query.value(1).toInt();
+        day.done = query.value(2).toInt();
+        counts.insert(QDate::fromJulianDay(query.value(0).toLongLong()), day);
+    }
+    query.finish();
+
+    for (const Task &occurrence : occurrencesInMonth(first)) {
+        DayCounts &day = counts[occurrence.date];
+        (occurrence.completed ? day.done : day.open) += 1;
+    }
+    return counts;
+}
+
+QVector<Task> DatabaseManager::getTasksOnDay(const QDate &day)
+{
+    TRACE_SCOPE("sql", "getTasksOnDay");
+    QVector<Task> tasks;
+    QSqlQuery &query = cachedQuery("SELECT id, text, date, tag, completed, rrule FROM Tasks "
+                                   "WHERE date = :date AND rrule IS NULL ORDER BY id");
+    query.bindValue(":date", day.toJulianDay());
     if (!query.exec()) {
-        qWarning() << "Failed to insert task:" << query.lastError().text();
+        qWarning() << "Failed to select tasks of day:" << query.lastError().text();
+        return tasks;
+    }
+    while (query.next())
+        tasks.append(taskFromQuery(query));
+    query.finish();
+
+    for (const Task &occurrence : occurrencesInMonth(day)) {
+        if (occurrence.date == day)
+            tasks.append(occurrence);
+    }
+    return tasks;
+}
+
+bool DatabaseManager::setOccurrenceState(qint64 taskId, const QDate &day, OccurrenceState state)
+{
+    TRACE_SCOPE("sql", "setOccurrenceState");
+    QSqlQuery &remove = cachedQuery("DELETE FROM TaskOccurrences WHERE task_id = :id AND day = :day");
+    QSqlQuery &insert = cachedQuery("INSERT OR REPLACE INTO TaskOccurrences (task_id, day, state) "
+                                    "VALUES (:id, :day, :state)");
+    QSqlQuery &query = state == OccurrenceOpen ? remove : insert;
+    query.bindValue(":id", taskId);
+    query.bindValue(":day", day.toJulianDay());
+    if (state != OccurrenceOpen)
+        query.bindValue(":state", int(state));
+    return execTaskWrite(query, "Failed to update task occurrence:");
+}
+
+QHash<qint64, QSet<QDate>> DatabaseManager::markedOccurrences(const QDate &from)
+{
+    TRACE_SCOPE("sql", "markedOccurrences");
+    QHash<qint64, QSet<QDate>> marked;
+    QSqlQuery &query = cachedQuery("SELECT task_id, day FROM TaskOccurrences WHERE day >= :from");
+    query.bindValue(":from", from.toJulianDay());
+    if (!query.exec())
+        qWarning() << "Failed to select task occurrences:" << query.lastError().text();
+    while (query.next())
+        marked[query.value(0).toLongLong()].insert(QDate::fromJulianDay(query.value(1).toLongLong()));
+    query.finish();
+    return marked;
+}
+
+const QVector<Task> &DatabaseManager::occurrencesInMonth(const QDate &month)
+{
+    TRACE_SCOPE("sql", "occurrencesInMonth");
+    static constexpr int MaxCachedMonths = 36;
+
+    // Любое изменение задач или отметок меняет номер состояния и сбрасывает кэш
+    const qint64 generation = tasksGeneration();
+    if (generation != m_occurrencesGeneration) {
+        m_occurrences.clear();
+        m_occurrencesGeneration = generation;
+    }
+
+    const QDate first(month.year(), month.month(), 1);
+    auto cached = m_occurrences.constFind(first);
+    if (cached != m_occurrences.constEnd())
+        return cached.value();
+    if (m_occurrences.size() >= MaxCachedMonths)
+        m_occurrences.clear();
+
+    const QDate last = first.addMonths(1).addDays(-1);
+    QVector<Task> occurrences;
+
+    QHash<QPair<qint64, qint64>, int> states;
+    QSqlQuery &marks = cachedQuery("SELECT task_id, day, state FROM TaskOccurrences WHERE day BETWEEN :from AND :to");
+    marks.bindValue(":from", first.toJulianDay());
+    marks.bindValue(":to", last.toJulianDay());
+    if (!marks.exec())
+        qWarning() << "Failed to select task occurrences:" << marks.lastError().text();
+    while (marks.next())
+        states.insert({marks.value(0).toLongLong(), marks.value(1).toLongLong()}, marks.value(2).toInt());
+    marks.finish();
+
+    // Серия - одна строка; её повторения считаются только для этого месяца.
+    // Выполненная серия (completed) закончена и повторений не даёт
+    QSqlQuery &series = cachedQuery("SELECT id, text, date, tag, completed, rrule FROM Tasks "
+                                    "WHERE rrule IS NOT NULL AND date <= :to AND completed = 0");
+    series.bindValue(":to", last.toJulianDay());
+    if (!series.exec())
+        qWarning() << "Failed to select recurring tasks:" << series.lastError().text();
+    while (series.next()) {
+        const Task task = taskFromQuery(series);
+        const Recurrence rule = Recurrence::parse(task.recurrence);
+        for (const QDate &day : rule.occurrences(task.date, first, last)) {
+            const int state = states.value({task.id, day.toJulianDay()}, OccurrenceOpen);
+            if (state == OccurrenceSkipped)
+                continue;
+            Task occurrence = task;
+            occurrence.date = day;
+            occurrence.completed = state == OccurrenceDone;
+            occurrences.append(occurrence);
+        }
+    }
+    series.finish();
+
+    return m_occurrences.insert(first, occurrences).value();
+}
+
+bool DatabaseManager::addTasks(QVector<Task> &tasks)
+{
+    TRACE_SCOPE_DETAIL("sql", "addTasks", QString::number(tasks.size()));
+    if (tasks.isEmpty())
+        return true;
+
+    if (!m_db.transaction()) {
+        qWarning() << "Failed to start transaction:" << m_db.lastError().text();
+        return false;
+    }
+
+    // Драйвер SQLite всё равно выполняет пакет построчно, поэтому строки
+    // вставляются по одной и id берётся из каждой вставки: подряд они
+    // идти не обязаны
+    QSqlQuery &query = cachedQuery("INSERT INTO Tasks (text, date, tag, completed, rrule) "
+                                   "VALUES (:text, :date, :tag, :completed, :rrule)");
+    QVector<qint64> ids;
+    ids.reserve(tasks.size());
+    for (const Task &task : std::as_const(tasks)) {
+        query.bindValue(":text", task.text);
+        query.bindValue(":date", dateValue(task.date));
+        query.bindValue(":tag", task.tag);
+        query.bindValue(":completed", task.completed);
+        query.bindValue(":rrule", ruleValue(task.recurrence));
+        if (!query.exec()) {
+            qWarning() << "Failed to insert tasks:" << query.lastError().text();
+            m_db.rollback();
+            return false;
+        }
+        ids.append(query.lastInsertId().toLongLong());
+    }
+    query.finish();
+    if (!bumpTasksGeneration()) {
+        m_db.rollback();
+        return false;
+    }
+
+    if (!m_db.commit()) {
+        qWarning() << "Failed to commit tasks:" << m_db.lastError().text();
+        m_db.rollback();
+        return false;
+    }
+
+    for (int i = 0; i < tasks.size(); ++i)
+        tasks[i].id = ids.at(i);
+    return true;
+}
+
+bool DatabaseManager::updateTasks(const QVector<Task> &tasks)
+{
+    TRACE_SCOPE_DETAIL("sql", "updateTasks", QString::number(tasks.size()));
+    return saveTaskChanges(tasks, {});
+}
+
+bool DatabaseManager::deleteTasks(const QVector<qint64> &ids)
+{
+    TRACE_SCOPE_DETAIL("sql", "deleteTasks", QString::number(ids.size()));
+    return saveTaskChanges({}, ids);
+}
+
+bool DatabaseManager::saveTaskChanges(const QVector<Task> &updated, const QVector<qint64> &removed)
+{
+    TRACE_SCOPE_DETAIL("sql", "saveTaskChanges", QString("%1/%2").arg(updated.size()).arg(removed.size()));
+    if (updated.isEmpty() && removed.isEmpty())
+        return true;
+
+    if (!m_db.transaction()) {
+        qWarning() << "Failed to start transaction:" << m_db.lastError().text();
+        return false;
+    }
+
+    if (!execTaskUpdates(updated) || !execTaskDeletes(removed) || !bumpTasksGeneration()) {
+        m_db.rollback();
+        return false;
+    }
+
+    if (!m_db.commit()) {
+        qWarning() << "Failed to commit tasks:" << m_db.lastError().text();
+        m_db.rollback();
+        return false;
+    }
+    return true;
+}
+
+bool DatabaseManager::execTaskUpdates(const QVector<Task> &tasks)
+{
+    if (tasks.isEmpty())
+        return true;
+
+    QVariantList ids, texts, dates, tags, states, rules;
+    for (const Task &task : tasks) {
+        ids.append(task.id);
+        texts.append(task.text);
+        dates.append(dateValue(task.date));
+        tags.append(task.tag);
+        states.append(task.completed);
+        rules.append(ruleValue(task.recurrence));
+    }
+
+    QSqlQuery &query = cachedQuery("UPDATE Tasks SET text = :text, date = :date, tag = :tag, "
+                                   "completed = :completed, rrule = :rrule WHERE id = :id");
+    query.bindValue(":text", texts);
+    query.bindValue(":date", dates);
+    query.bindValue(":tag", tags);
+    query.bindValue(":completed", states);
+    query.bindValue(":rrule", rules);
+    query.bindValue(":id", ids);
+    if (!query.execBatch()) {
+        qWarning() << "Failed to update tasks:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool DatabaseManager::execTaskDeletes(const QVector<qint64> &ids)
+{
+    if (ids.isEmpty())
+        return true;
+
+    QVariantList values;
+    values.reserve(ids.size());
+    for (qint64 id : ids)
+        values.append(id);
+
+    QSqlQuery &query = cachedQuery("DELETE FROM Tasks WHERE id = :id");
+    query.bindValue(":id", values);
+    if (!query.execBatch()) {
+        qWarning() << "Failed to delete tasks:" << query.lastError().text();
         return false;
     }
     return true;
 }
 
-QSqlQuery DatabaseManager::getAllTasks()
+bool DatabaseManager::importTasksFromJson(const QString &path)
 {
-    QSqlQuery query("SELECT id, text, date, tag FROM Tasks ORDER BY date");
-    return query;
+    TRACE_SCOPE_DETAIL("sql", "importTasksFromJson", path);
+    QVector<Task> tasks;
+    {
+        TaskJournal journal(path);
+        tasks = journal.load();
+    }
+
+    if (!addTasks(tasks)) {
+        qWarning() << "Failed to import" << path;
+        return false;
+    }
+
+    // Старые файлы переименовываются, чтобы импорт не повторился
+    const QStringList files = { path, path + ".log", path + ".log.old" };
+    for (const QString &file : files) {
+        if (!QFile::exists(file))
+            continue;
+        QFile::remove(file + ".imported");
+        // Задачи уже в базе: неудавшееся переименование повторит импорт
+        // при следующем запуске и размножит их, поэтому файл удаляется
+        if (!QFile::rename(file, file + ".imported") && !QFile::remove(file))
+            qWarning() << "Failed to retire imported file:" << file;
+    }
+    return true;
 }
 
-bool DatabaseManager::addNote(const QString &text)
+qint64 DatabaseManager::addNote(const QString &text, const QString &plainText)
 {
-    QSqlQuery query;
-    query.prepare("INSERT INTO Notes (text) VALUES (:text)");
+    TRACE_SCOPE("sql", "addNote");
+    if (!m_db.transaction()) {
+        qWarning() << "Failed to start transaction:" << m_db.lastError().text();
+        return -1;
+    }
+
+    QSqlQuery &query = cachedQuery("INSERT INTO Notes (text, plain) VALUES (:text, :plain)");
     query.bindValue(":text", text);
+    query.bindValue(":plain", plainText);
     if (!query.exec()) {
         qWarning() << "Failed to insert note:" << query.lastError().text();
-        return false;
+        m_db.rollback();
+        return -1;
     }
-    return true;
+    const qint64 id = query.lastInsertId().toLongLong();
+
+    if (!appendNoteRevision(id, QByteArray(), text.toUtf8())) {
+        m_db.rollback();
+        return -1;
+    }
+
+    if (!m_db.commit()) {
+        qWarning() << "Failed to commit note:" << m_db.lastError().text();
+        m_db.rollback();
+        return -1;
+    }
+    return id;
 }
 
-bool DatabaseManager::updateNote(int id, const QString &text)
+bool DatabaseManager::updateNote(qint64 id, const QString &text, const QString &plainText)
 {
-    QSqlQuery query;
-    query.prepare("UPDATE Notes SET text = :text WHERE id = :id");
+    TRACE_SCOPE("sql", "updateNote");
+    if (!m_db.transaction()) {
+        qWarning() << "Failed to start transaction:" << m_db.lastError().text();
+        return false;
+    }
+
+    // Прежний текст нужен для разности и для заметок, созданных до появления истории
+    QSqlQuery &select = cachedQuery("SELECT text FROM Notes WHERE id = :id");
+    select.bindValue(":id", id);
+    if (!select.exec()) {
+        qWarning() << "Failed to read note:" << select.lastError().text();
+        m_db.rollback();
+        return false;
+    }
+    const QByteArray previous = select.next() ? select.value(0).toString().toUtf8() : QByteArray();
+    select.finish();
+
+    QSqlQuery &query = cachedQuery("UPDATE Notes SET text = :text, plain = :plain WHERE id = :id");
     query.bindValue(":text", text);
+    query.bindValue(":plain", plainText);
     query.bindValue(":id", id);
     if (!query.exec()) {
         qWarning() << "Failed to update note:" << query.lastError().text();
+        m_db.rollback();
+        return false;
+    }
+
+    if (!appendNoteRevision(id, previous, text.toUtf8())) {
+        m_db.rollback();
+        return false;
+    }
+
+    if (!m_db.commit()) {
+        qWarning() << "Failed to commit note:" << m_db.lastError().text();
+        m_db.rollback();
         return false;
     }
     return true;
 }
 
-QSqlQuery DatabaseManager::getNoteById(int id)
+bool DatabaseManager::deleteNote(qint64 id)
 {
-    QSqlQuery query;
-    query.prepare("SELECT id, text FROM Notes WHERE id = :id");
+    TRACE_SCOPE("sql", "deleteNote");
+    if (!m_db.transaction()) {
+        qWarning() << "Failed to start transaction:" << m_db.lastError().text();
+        return false;
+    }
+
+    QSqlQuery &query = cachedQuery("DELETE FROM Notes WHERE id = :id");
     query.bindValue(":id", id);
-    query.exec();
-    return query;
+    QSqlQuery &history = cachedQuery("DELETE FROM NoteRevisions WHERE note_id = :id");
+    history.bindValue(":id", id);
+    QSqlQuery &refs = cachedQuery("DELETE FROM NoteBlobRefs WHERE note_id = :id");
+    refs.bindValue(":id", id);
+    if (!query.exec() || !history.exec() || !refs.exec()) {
+        qWarning() << "Failed to delete note:" << query.lastError().text() << history.lastError().text()
+                   << refs.lastError().text();
+        m_db.rollback();
+        return false;
+    }
+
+    if (!m_db.commit()) {
+        qWarning() << "Failed to commit note:" << m_db.lastError().text();
+        m_db.rollback();
+        return false;
+    }
+    return true;
+}
+
+bool DatabaseManager::appendNoteRevision(qint64 noteId, const QByteArray &previous, const QByteArray &text)
+{
+    TRACE_SCOPE("sql", "appendNoteRevision");
+    QSqlQuery &last = cachedQuery("SELECT MAX(revision), MAX(CASE WHEN flags & 1 = 0 THEN revision END) "
+                                  "FROM NoteRevisions WHERE note_id = :id");
+    last.bindValue(":id", noteId);
+    if (!last.exec() || !last.next()) {
+        qWarning() << "Failed to read note history:" << last.lastError().text();
+        return false;
+    }
+    int latest = last.value(0).isNull() ? 0 : last.value(0).toInt();
+    int keyframe = last.value(1).isNull() ? 0 : last.value(1).toInt();
+    last.finish();
+
+    // Заметка из времени до истории: прежний текст становится первой ревизией
+    if (latest == 0 && !previous.isNull()) {
+        int flags = 0;
+        const QByteArray data = NoteHistory::pack(previous, m_historyPolicy.compressThreshold, &flags);
+        if (!recordBlobRefs(noteId, previous) || !insertNoteRevision(noteId, 1, flags, previous.size(), data))
+            return false;
+        if (previous == text)
+            return true;
+        latest = keyframe = 1;
+    }
+
+    const int revision = latest + 1;
+    int flags = 0;
+    QByteArray payload = text;
+    // Разность пишется, пока ключевой кадр недалеко и она заметно меньше текста
+    if (latest > 0 && revision - keyframe < m_historyPolicy.keyframeInterval) {
+        const QByteArray delta = NoteHistory::makeDelta(previous, text);
+        if (delta.size() < text.size() / 2) {
+            payload = delta;
+            flags |= NoteHistory::Delta;
+        }
+    }
+    const QByteArray data = NoteHistory::pack(payload, m_historyPolicy.compressThreshold, &flags);
+    if (!recordBlobRefs(noteId, text) || !insertNoteRevision(noteId, revision, flags, text.size(), data))
+        return false;
+    return pruneNoteRevisions(noteId, revision);
+}
+
+bool DatabaseManager::insertNoteRevision(qint64 noteId, int revision, int flags, int textSize, const QByteArray &data)
+{
+    QSqlQuery &query = cachedQuery("INSERT INTO NoteRevisions (note_id, revision, flags, created, size, data) "
+                                   "VALUES (:id, :revision, :flags, :created, :size, :data)");
+    query.bindValue(":id", noteId);
+    query.bindValue(":revision", revision);
+    query.bindValue(":flags", flags);
+    query.bindValue(":created", QDateTime::currentSecsSinceEpoch());
+    query.bindValue(":size", textSize);
+    query.bindValue(":data", data);
+    if (!query.exec()) {
+        qWarning() << "Failed to insert note revision:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool DatabaseManager::pruneNoteRevisions(qint64 noteId, int latest)
+{
+    const int oldestKept = latest - m_historyPolicy.keepRevisions + 1;
+    if (oldestKept <= 1)
+        return true;
+
+    // Удаляется всё раньше ключевого кадра, от которого восстанавливается oldestKept
+    QSqlQuery &query = cachedQuery("DELETE FROM NoteRevisions WHERE note_id = :id AND revision < ("
+                                   "SELECT MAX(revision) FROM NoteRevisions WHERE note_id = :id2 "
+                                   "AND revision <= :oldest AND flags & 1 = 0)");
+    query.bindValue(":id", noteId);
+    query.bindValue(":id2", noteId);
+    query.bindValue(":oldest", oldestKept);
+    if (!query.exec()) {
+        qWarning() << "Failed to prune note history:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+QVector<NoteRevision> DatabaseManager::noteRevisions(qint64 noteId)
+{
+    TRACE_SCOPE("sql", "noteRevisions");
+    QVector<NoteRevision> revisions;
+    QSqlQuery &query = cachedQuery("SELECT revision, flags, created, size, length(data) FROM NoteRevisions "
+                                   "WHERE note_id = :id ORDER BY revision DESC");
+    query.bindValue(":id", noteId);
+    if (!query.exec()) {
+        qWarning() << "Failed to read note history:" << query.lastError().text();
+        return revisions;
+    }
+    while (query.next()) {
+        NoteRevision revision;
+        revision.noteId = noteId;
+        revision.revision = query.value(0).toInt();
+        revision.keyframe = !(query.value(1).toInt() & NoteHistory::Delta);
+        revision.created = QDateTime::fromSecsSinceEpoch(query.value(2).toLongLong());
+        revision.textSize = query.value(3).toInt();
+        revision.storedSize = query.value(4).toInt();
+        revisions.append(revision);
+    }
+    return revisions;
+}
+
+QString DatabaseManager::noteRevisionText(qint64 noteId, int revision)
+{
+    TRACE_SCOPE("sql", "noteRevisionText");
+    // Ближайший ключевой кадр и разности после него - не больше keyframeInterval строк
+    QSqlQuery &query = cachedQuery("SELECT revision, flags, data FROM NoteRevisions WHERE note_id = :id "
+                                   "AND revision <= :revision AND revision >= ("
+                                   "SELECT MAX(revision) FROM NoteRevisions WHERE note_id = :id2 "
+                                   "AND revision <= :revision2 AND flags & 1 = 0) ORDER BY revision");
+    query.bindValue(":id", noteId);
+    query.bindValue(":revision", revision);
+    query.bindValue(":id2", noteId);
+    query.bindValue(":revision2", revision);
+    if (!query.exec()) {
+        qWarning() << "Failed to read note revision:" << query.lastError().text();
+        return QString();
+    }
+
+    QByteArray text;
+    int expected = -1;
+    while (query.next()) {
+        const int current = query.value(0).toInt();
+        const int flags = query.value(1).toInt();
+        QByteArray payload;
+        if ((expected >= 0 && current != expected)
+            || !NoteHistory::unpack(query.value(2).toByteArray(), flags, &payload)
+            || ((flags & NoteHistory::Delta) && !NoteHistory::applyDelta(text, payload, &text))) {
+            qWarning() << "Failed to restore note revision" << revision << "of note" << noteId;
+            return QString();
+        }
+        if (!(flags & NoteHistory::Delta))
+            text = payload;
+        expected = current + 1;
+    }
+    query.finish();
+    if (expected != revision + 1)
+        return QString();
+    return QString::fromUtf8(text);
+}
+
+Note DatabaseManager::getNoteById(qint64 id)
+{
+    TRACE_SCOPE("sql", "getNoteById");
+    Note note;
+    QSqlQuery &query = cachedQuery("SELECT id, text, plain FROM Notes WHERE id = :id");
+    query.bindValue(":id", id);
+    if (!query.exec()) {
+        qWarning() << "Failed to select note:" << query.lastError().text();
+    } else if (query.next()) {
+        note.id = query.value(0).toLongLong();
+        note.html = query.value(1).toString();
+        note.plainText = query.value(2).toString();
+    }
+    query.finish();
+    return note;
+}
+
+QVector<Note> DatabaseManager::getAllNotes()
+{
+    TRACE_SCOPE("sql", "getAllNotes");
+    QVector<Note> notes;
+    QSqlQuery query(m_db);
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT id, text, plain FROM Notes ORDER BY id")) {
+        qWarning() << "Failed to select notes:" << query.lastError().text();
+        return notes;
+    }
+    while (query.next()) {
+        Note note;
+        note.id = query.value(0).toLongLong();
+        note.html = query.value(1).toString();
+        note.plainText = query.value(2).toString();
+        notes.append(note);
+    }
+    return notes;
+}
+
+QString DatabaseManager::ftsQuery(const QString &text)
+{
+    // Каждое слово - строка в кавычках с поиском по префиксу: "сло"*
+    QStringList terms;
+    const QStringList words = text.split(' ', Qt::SkipEmptyParts);
+    for (QString word : words) {
+        word.replace('"', "\"\"");
+        terms.append('"' + word + "\"*");
+    }
+    return terms.join(' ');
+}
+
+QVector<SearchHit> DatabaseManager::search(const QString &text, int limit)
+{
+    TRACE_SCOPE_DETAIL("sql", "search", text);
+    QVector<SearchHit> hits;
+    const QString match = ftsQuery(text.simplified());
+    if (match.isEmpty())
+        return hits;
+
+    // Каждая таблица отдаёт свои лучшие limit строк по индексу (ORDER BY rank)
+    QSqlQuery &query = cachedQuery(
+        "SELECT kind, id, snip, score FROM ("
+        "  SELECT 0 AS kind, rowid AS id, snippet(TasksFts, 0, '[', ']', '…', 10) AS snip, rank AS score "
+        "  FROM TasksFts WHERE TasksFts MATCH :taskMatch ORDER BY rank LIMIT :taskLimit) "
+        "UNION ALL "
+        "SELECT kind, id, snip, score FROM ("
+        "  SELECT 1 AS kind, rowid AS id, snippet(NotesFts, 0, '[', ']', '…', 10) AS snip, rank AS score "
+        "  FROM NotesFts WHERE NotesFts MATCH :noteMatch ORDER BY rank LIMIT :noteLimit)");
+    query.bindValue(":taskMatch", match);
+    query.bindValue(":taskLimit", limit);
+    query.bindValue(":noteMatch", match);
+    query.bindValue(":noteLimit", limit);
+    if (!query.exec()) {
+        qWarning() << "Failed to search:" << query.lastError().text();
+        return hits;
+    }
+    // Лучшая (наименьшая) оценка каждой таблицы - первая её строка
+    double best[2] = {0, 0};
+    while (query.next()) {
+        SearchHit hit;
+        hit.kind = query.value(0).toInt() == 0 ? SearchHit::TaskHit : SearchHit::NoteHit;
+        hit.id = query.value(1).toLongLong();
+        hit.snippet = query.value(2).toString();
+        hit.rank = query.value(3).toDouble();
+        best[hit.kind] = qMin(best[hit.kind], hit.rank);
+        hits.append(hit);
+    }
+    query.finish();
+
+    // bm25 двух таблиц несравнимы: статистика корпусов разная, и короткие
+    // задачи вытесняли бы заметки. Оценка делится на лучшую в своей таблице,
+    // списки сливаются по доле от лучшего совпадения
+    for (SearchHit &hit : hits)
+        hit.rank = best[hit.kind] < 0 ? -(hit.rank / best[hit.kind]) : 0;
+    std::stable_sort(hits.begin(), hits.end(), [](const SearchHit &a, const SearchHit &b) {
+        return a.rank < b.rank;
+    });
+    if (hits.size() > limit)
+        hits.resize(limit);
+    return hits;
+}
+
+qint64 DatabaseManager::storeBlob(const QByteArray &data)
+{
+    TRACE_SCOPE("sql", "storeBlob");
+    const QString hash = QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex());
+
+    // Повторное вложение того же файла не пишет данные второй раз
+    QSqlQuery &insert = cachedQuery("INSERT INTO Blobs (hash, mime, size, data) VALUES (:hash, :mime, :size, :data) "
+                                    "ON CONFLICT(hash) DO NOTHING");
+    insert.bindValue(":hash", hash);
+    insert.bindValue(":mime", QMimeDatabase().mimeTypeForData(data).name());
+    insert.bindValue(":size", data.size());
+    insert.bindValue(":data", data);
+    if (!insert.exec()) {
+        qWarning() << "Failed to store blob:" << insert.lastError().text();
+        return -1;
+    }
+
+    QSqlQuery &select = cachedQuery("SELECT id FROM Blobs WHERE hash = :hash");
+    select.bindValue(":hash", hash);
+    if (!select.exec() || !select.next()) {
+        qWarning() << "Failed to find blob:" << select.lastError().text();
+        return -1;
+    }
+    const qint64 id = select.value(0).toLongLong();
+    select.finish();
+    return id;
+}
+
+QByteArray DatabaseManager::blobData(qint64 id)
+{
+    TRACE_SCOPE("sql", "blobData");
+    QSqlQuery &query = cachedQuery("SELECT data FROM Blobs WHERE id = :id");
+    query.bindValue(":id", id);
+    if (!query.exec()) {
+        qWarning() << "Failed to read blob:" << query.lastError().text();
+        return QByteArray();
+    }
+    const QByteArray data = query.next() ? query.value(0).toByteArray() : QByteArray();
+    query.finish();
+    return data;
+}
+
+bool DatabaseManager::pruneBlobs()
+{
+    TRACE_SCOPE("sql", "pruneBlobs");
+    // QTextDocument::toHtml всегда пишет атрибуты в двойных кавычках, кавычка
+    // после id отличает blob:1 от blob:12
+    QSqlQuery query(m_db);
+    if (!query.exec("DELETE FROM Blobs WHERE NOT EXISTS ("
+                    "SELECT 1 FROM Notes WHERE instr(Notes.text, 'blob:' || Blobs.id || '\"') > 0) "
+                    "AND NOT EXISTS (SELECT 1 FROM NoteBlobRefs WHERE NoteBlobRefs.blob_id = Blobs.id)")) {
+        qWarning() << "Failed to prune blobs:" << query.lastError().text();
+        return false;
+    }
+    return true;
 }
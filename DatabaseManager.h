@@ -5,7 +5,32 @@
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QSqlError>
+#include <QHash>
+#include <QMap>
+#include <QSet>
+#include <QVector>
+#include <QDate>
 #include <QDebug>
+#include "Task.h"
+#include "Note.h"
+#include "NoteHistory.h"
+#include "SearchHit.h"
+
+// Параметры SQLite, применяемые при открытии базы
+struct DatabasePragmas {
+    QString journalMode = "WAL";
+    QString synchronous = "NORMAL";
+    int cacheSizeKiB = 16 * 1024;
+    qint64 mmapSize = 256LL * 1024 * 1024;
+    int busyTimeoutMs = 5000;   // ожидание блокировки писателя вместо ошибки SQLITE_BUSY
+};
+
+// Число задач за день; открытые задачи прошедших дней - просроченные
+struct DayCounts {
+    int open = 0;
+    int done = 0;
+    int total() const { return open + done; }
+};
 
 class DatabaseManager : public QObject
 {
@@ -14,59 +39,124 @@ public:
     explicit DatabaseManager(QObject *parent = nullptr);
     ~DatabaseManager();
 
-    bool openDatabase(const QString &path);
+    // Пустое имя - соединение Qt по умолчанию; именованное соединение
+    // принадлежит менеджеру и удаляется вместе с ним
+    bool openDatabase(const QString &path, const DatabasePragmas &pragmas = DatabasePragmas(),
+                      const QString &connectionName = QString());
     bool createTables();
+    QSqlDatabase database() const { return m_db; }
 
     // Методы для задач
-    bool addTask(const QString &text, const QString &date, const QString &tag);
-    QSqlQuery getAllTasks();
-
-    // Методы для заметок
-    bool addNote(const QString &text);
-    bool updateNote(int id, const QString &text);
-    QSqlQuery getNoteById(int id);
-
-    // Получение задачи по id
-    QSqlQuery getTaskById(int id)
-    {
-        QSqlQuery query;
-        query.prepare("SELECT id, text, date, tag FROM Tasks WHERE id = :id");
-        query.bindValue(":id", id);
-        query.exec();
-        return query;
-    }
-
-    // Обновление задачи
-    bool updateTask(int id, const QString &text, const QString &date, const QString &tag)
-    {
-        QSqlQuery query;
-        query.prepare("UPDATE Tasks SET text = :text, date = :date, tag = :tag WHERE id = :id");
-        query.bindValue(":text", text);
-        query.bindValue(":date", date);
-        query.bindValue(":tag", tag);
-        query.bindValue(":id", id);
-        if (!query.exec()) {
-            qWarning() << "Failed to update task:" << query.lastError().text();
-            return false;
-        }
-        return true;
-    }
-
-    // Удаление задачи
-    bool deleteTask(int id)
-    {
-        QSqlQuery query;
-        query.prepare("DELETE FROM Tasks WHERE id = :id");
-        query.bindValue(":id", id);
-        if (!query.exec()) {
-            qWarning() << "Failed to delete task:" << query.lastError().text();
-            return false;
-        }
-        return true;
-    }
+    // Возвращает id новой задачи или -1 при ошибке
+    qint64 addTask(const QString &text, const QDate &date, const QString &tag, bool completed = false,
+                   const QString &recurrence = QString());
+    bool updateTask(qint64 id, const QString &text, const QDate &date, const QString &tag);
+    bool setTaskCompleted(qint64 id, bool completed);
+    bool deleteTask(qint64 id);
+    // Задача с id <= 0, если такой нет
+    Task getTaskById(qint64 id);
+    QVector<Task> getAllTasks();
+
+    // Выборки по сроку: даты хранятся номером юлианского дня и идут по индексу Tasks(date)
+    QVector<Task> getTasksInRange(const QDate &from, const QDate &to);
+    QVector<Task> getOverdue();
+    QMap<QDate, DayCounts> countByDay(const QDate &month);
+    // Задачи одного дня, для списка под календарём, вместе с повторениями
+    // повторяющихся задач (у повторения date - его день, completed - его отметка)
+    QVector<Task> getTasksOnDay(const QDate &day);
+
+    // Отметка одного повторения повторяющейся задачи; OccurrenceOpen снимает отметку
+    enum OccurrenceState { OccurrenceOpen = 0, OccurrenceDone = 1, OccurrenceSkipped = 2 };
+    bool setOccurrenceState(qint64 taskId, const QDate &day, OccurrenceState state);
+    // Отмеченные (выполненные или пропущенные) повторения начиная с from, по задачам
+    QHash<qint64, QSet<QDate>> markedOccurrences(const QDate &from);
+
+    // Задача из текущей строки запроса (id, text, date, tag, completed)
+    static Task taskFromQuery(const QSqlQuery &query);
+
+    // Пакетные операции: одна транзакция и один подготовленный запрос на пакет.
+    // addTasks заполняет id у переданных задач.
+    bool addTasks(QVector<Task> &tasks);
+    bool updateTasks(const QVector<Task> &tasks);
+    bool deleteTasks(const QVector<qint64> &ids);
+    // Изменения и удаления одной транзакцией (отложенное сохранение AsyncDatabase)
+    bool saveTaskChanges(const QVector<Task> &updated, const QVector<qint64> &removed);
+
+    // Номер состояния задач, растёт с каждой меняющей их транзакцией; -1 при ошибке
+    qint64 tasksGeneration();
+
+    // Однократный перенос задач из tasks.json (снимок + журнал) одной транзакцией
+    bool importTasksFromJson(const QString &path);
+
+    // Методы для заметок: text - HTML, plainText - он же без разметки для поиска
+    // addNote возвращает id новой заметки или -1 при ошибке
+    qint64 addNote(const QString &text, const QString &plainText);
+    bool updateNote(qint64 id, const QString &text, const QString &plainText);
+    bool deleteNote(qint64 id);
+    // Заметка с id <= 0, если такой нет
+    Note getNoteById(qint64 id);
+    QVector<Note> getAllNotes();
+
+    // История заметок: addNote/updateNote записывают ревизию HTML в той же
+    // транзакции, см. NoteHistoryPolicy
+    void setNoteHistoryPolicy(const NoteHistoryPolicy &policy) { m_historyPolicy = policy; }
+    // Ревизии заметки, новые первыми
+    QVector<NoteRevision> noteRevisions(qint64 noteId);
+    // HTML ревизии; пустая строка, если ревизии нет или она повреждена
+    QString noteRevisionText(qint64 noteId, int revision);
+
+    // Вложения заметок хранятся один раз по SHA-256 содержимого, заметки
+    // ссылаются на них адресом blob:<id>. storeBlob возвращает id уже
+    // сохранённого вложения с тем же содержимым или -1 при ошибке.
+    qint64 storeBlob(const QByteArray &data);
+    QByteArray blobData(qint64 id);
+    // Удаляет вложения, на которые не ссылается ни одна заметка и её история
+    bool pruneBlobs();
+
+    // Полнотекстовый поиск (FTS5) по задачам и заметкам, лучшие совпадения первыми.
+    // Каждое слово запроса ищется как префикс, поэтому годится для поиска по мере ввода.
+    QVector<SearchHit> search(const QString &text, int limit = 50);
 
 private:
+    // Подготовленный запрос, живущий до закрытия соединения. Неудачно
+    // подготовленный в кэш не попадает и готовится заново при следующем вызове
+    QSqlQuery &cachedQuery(const QString &sql);
+    void clearStatementCache();
+    // Выполняет подготовленный запрос задач и читает все строки
+    QVector<Task> selectTasks(QSqlQuery &query, const char *failure);
+    // Тела пакетных операций без своей транзакции
+    bool execTaskUpdates(const QVector<Task> &tasks);
+    bool execTaskDeletes(const QVector<qint64> &ids);
+    bool applyPragmas(const DatabasePragmas &pragmas);
+    bool ensureColumn(const QString &table, const QString &column, const QString &definition);
+    bool migrateDatesToJulianDay();
+    bool createSearchIndex();
+    bool createBlobTable();
+    bool createGenerationCounter();
+    // Увеличивает tasks_generation; вызывается внутри транзакции, меняющей задачи
+    bool bumpTasksGeneration();
+    // Одиночный запрос к задачам и bumpTasksGeneration одной транзакцией
+    bool execTaskWrite(QSqlQuery &query, const char *failure);
+    bool createNoteHistoryTable();
+    bool createOccurrenceTable();
+    // Повторения за месяц с отметками, кэш по месяцам до смены tasksGeneration
+    const QVector<Task> &occurrencesInMonth(const QDate &month);
+    bool appendNoteRevision(qint64 noteId, const QByteArray &previous, const QByteArray &text);
+    bool insertNoteRevision(qint64 noteId, int revision, int flags, int textSize, const QByteArray &data);
+    bool pruneNoteRevisions(qint64 noteId, int latest);
+    bool recordBlobRefs(qint64 noteId, const QByteArray &html);
+    bool migrateNoteImagesToBlobs();
+    static QString ftsQuery(const QString &text);
+    static QVariant dateValue(const QDate &date);
+    static QVariant ruleValue(const QString &rule);
+
     QSqlDatabase m_db;
+    bool m_ownsConnection = false;
+    QHash<QString, QSqlQuery *> m_statements;
+    QHash<QString, QSqlQuery *> m_failedStatements;
+    NoteHistoryPolicy m_historyPolicy;
+    QHash<QDate, QVector<Task>> m_occurrences;
+    qint64 m_occurrencesGeneration = -1;
 };
 
 #endif // DATABASEMANAGER_H
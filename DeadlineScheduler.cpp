@@ -0,0 +1,302 @@
+#include "DeadlineScheduler.h"
+#include "Trace.h"
+
+namespace {
+
+// Дальние сроки таймер ждёт частями: интервал QTimer ограничен int,
+// а после сна системы вершина кучи перепроверяется хотя бы раз в сутки
+const qint64 MaxDelayMs = 24LL * 60 * 60 * 1000;
+// VeryCoarseTimer округляет интервал до целых секунд: последние секунды
+// перед сроком ждёт точный таймер, иначе остаток меньше 500 мс стал бы
+// нулём и таймер просыпался бы впустую до самого срока
+const qint64 PreciseDelayMs = 2000;
+// Сколько лет вперёд искать следующее повторение (29 февраля - раз в 4 года)
+const int RecurrenceSearchYears = 8;
+
+} // namespace
+
+DeadlineScheduler::DeadlineScheduler(const QTime &reminderTime, QObject *parent)
+    : QObject(parent), m_reminderTime(reminderTime)
+{
+    m_timer.setSingleShot(true);
+    m_timer.setTimerType(Qt::VeryCoarseTimer);
+    connect(&m_timer, &QTimer::timeout, this, &DeadlineScheduler::fire);
+}
+
+void DeadlineScheduler::setTasks(const QVector<Task> &tasks)
+{
+    TRACE_SCOPE_DETAIL("deadline", "setTasks", QString::number(tasks.size()));
+    m_heap.clear();
+    m_positions.clear();
+    m_series.clear();
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (const Task &task : tasks) {
+        if (task.completed || !task.date.isValid())
+            continue;
+        Recurrence rule;
+        if (task.isRecurring())
+            rule = Recurrence::parse(task.recurrence);
+        const qint64 due = nextDue(task.id, task.date, rule.isValid() ? &rule : nullptr, now);
+        if (due < 0)
+            continue;
+        if (rule.isValid())
+            m_series.insert(task.id, {task.date, rule});
+        m_positions.insert(task.id, m_heap.size());
+        m_heap.append({due, task.id});
+    }
+
+    // Построение кучи снизу вверх - O(n), а не n вставок по O(log n)
+    for (int i = m_heap.size() / 2 - 1; i >= 0; --i)
+        siftDown(i);
+    arm();
+}
+
+void DeadlineScheduler::updateTask(const Task &task)
+{
+    Recurrence rule;
+    if (task.isRecurring())
+        rule = Recurrence::parse(task.recurrence);
+    const qint64 due = task.completed
+        ? -1 : nextDue(task.id, task.date, rule.isValid() ? &rule : nullptr, QDateTime::currentMSecsSinceEpoch());
+    if (due < 0) {
+        // Задача остаётся в списке, её отметки повторений сохраняются
+        m_series.remove(task.id);
+        auto it = m_positions.constFind(task.id);
+        if (it != m_positions.constEnd()) {
+            removeAt(it.value());
+            arm();
+        }
+        return;
+    }
+
+    if (rule.isValid())
+        m_series.insert(task.id, {task.date, rule});
+    else
+        m_series.remove(task.id);
+    setDue(task.id, due);
+    arm();
+}
+
+void DeadlineScheduler::removeTask(qint64 id)
+{
+    m_series.remove(id);
+    m_marked.remove(id);
+    auto it = m_positions.constFind(id);
+    if (it == m_positions.constEnd())
+        return;
+    removeAt(it.value());
+    arm();
+}
+
+void DeadlineScheduler::clear()
+{
+    m_heap.clear();
+    m_positions.clear();
+    m_series.clear();
+    m_marked.clear();
+    arm();
+}
+
+void DeadlineScheduler::setMarkedDays(const QHash<qint64, QSet<QDate>> &marked)
+{
+    const QHash<qint64, QSet<QDate>> previous = m_marked;
+    m_marked = marked;
+    for (auto it = marked.constBegin(); it != marked.constEnd(); ++it)
+        reschedule(it.key());
+    for (auto it = previous.constBegin(); it != previous.constEnd(); ++it) {
+        if (!marked.contains(it.key()))
+            reschedule(it.key());
+    }
+    arm();
+}
+
+void DeadlineScheduler::setDayMarked(qint64 id, const QDate &day, bool marked)
+{
+    if (marked) {
+        m_marked[id].insert(day);
+    } else {
+        auto it = m_marked.find(id);
+        if (it == m_marked.end())
+            return;
+        it->remove(day);
+        if (it->isEmpty())
+            m_marked.erase(it);
+    }
+    reschedule(id);
+    arm();
+}
+
+void DeadlineScheduler::reschedule(qint64 id)
+{
+    // Разовые задачи отметок повторений не имеют
+    auto series = m_series.constFind(id);
+    if (series == m_series.constEnd())
+        return;
+    const qint64 due = nextDue(id, series->start, &series->rule, QDateTime::currentMSecsSinceEpoch());
+    if (due >= 0) {
+        setDue(id, due);
+        return;
+    }
+    // Серия остаётся известной: снятая позже отметка вернёт её в кучу
+    auto it = m_positions.constFind(id);
+    if (it != m_positions.constEnd())
+        removeAt(it.value());
+}
+
+QDateTime DeadlineScheduler::nextDeadline() const
+{
+    return m_heap.isEmpty() ? QDateTime() : QDateTime::fromMSecsSinceEpoch(m_heap.first().due);
+}
+
+qint64 DeadlineScheduler::deadlineOf(const QDate &date) const
+{
+    return QDateTime(date, m_reminderTime).toMSecsSinceEpoch();
+}
+
+qint64 DeadlineScheduler::nextDue(qint64 id, const QDate &date, const Recurrence *rule, qint64 now) const
+{
+    if (!date.isValid())
+        return -1;
+    if (!rule) {
+        const qint64 due = deadlineOf(date);
+        return due > now ? due : -1;
+    }
+
+    // Повторения считаются окнами по году начиная с сегодняшнего дня
+    const auto marked = m_marked.constFind(id);
+    const bool hasMarks = marked != m_marked.constEnd();
+    QDate from = qMax(date, QDateTime::fromMSecsSinceEpoch(now).date());
+    for (int window = 0; window < RecurrenceSearchYears; ++window) {
+        const QDate to = from.addYears(1);
+        for (const QDate &day : rule->occurrences(date, from, to)) {
+            if (hasMarks && marked->contains(day))
+                continue;
+            const qint64 due = deadlineOf(day);
+            if (due > now)
+                return due;
+        }
+        from = to.addDays(1);
+    }
+    return -1;
+}
+
+void DeadlineScheduler::setDue(qint64 id, qint64 due)
+{
+    auto it = m_positions.constFind(id);
+    if (it == m_positions.constEnd()) {
+        m_positions.insert(id, m_heap.size());
+        m_heap.append({due, id});
+        siftUp(m_heap.size() - 1);
+        return;
+    }
+
+    const int index = it.value();
+    const qint64 previous = m_heap.at(index).due;
+    m_heap[index].due = due;
+    if (due < previous)
+        siftUp(index);
+    else
+        siftDown(index);
+}
+
+void DeadlineScheduler::removeAt(int index)
+{
+    m_positions.remove(m_heap.at(index).id);
+    const Entry last = m_heap.takeLast();
+    if (index == m_heap.size())
+        return;
+
+    // На место удалённой встаёт последняя запись и всплывает или тонет
+    place(index, last);
+    if (index > 0 && last.due < m_heap.at((index - 1) / 2).due)
+        siftUp(index);
+    else
+        siftDown(index);
+}
+
+void DeadlineScheduler::place(int index, const Entry &entry)
+{
+    m_heap[index] = entry;
+    m_positions[entry.id] = index;
+}
+
+void DeadlineScheduler::siftUp(int index)
+{
+    const Entry entry = m_heap.at(index);
+    while (index > 0) {
+        const int parent = (index - 1) / 2;
+        if (m_heap.at(parent).due <= entry.due)
+            break;
+        place(index, m_heap.at(parent));
+        index = parent;
+    }
+    place(index, entry);
+}
+
+void DeadlineScheduler::siftDown(int index)
+{
+    const Entry entry = m_heap.at(index);
+    const int size = m_heap.size();
+    for (;;) {
+        int child = 2 * index + 1;
+        if (child >= size)
+            break;
+        if (child + 1 < size && m_heap.at(child + 1).due < m_heap.at(child).due)
+            ++child;
+        if (entry.due <= m_heap.at(child).due)
+            break;
+        place(index, m_heap.at(child));
+        index = child;
+    }
+    place(index, entry);
+}
+
+void DeadlineScheduler::arm()
+{
+    if (m_heap.isEmpty()) {
+        m_timer.stop();
+        m_armedDue = -1;
+        return;
+    }
+
+    // Таймер перезапускается, только если сменилась вершина кучи
+    const qint64 due = m_heap.first().due;
+    if (due == m_armedDue && m_timer.isActive())
+        return;
+    m_armedDue = due;
+    qint64 delay = qBound<qint64>(0, due - QDateTime::currentMSecsSinceEpoch(), MaxDelayMs);
+    if (delay < PreciseDelayMs) {
+        m_timer.setTimerType(Qt::PreciseTimer);
+    } else {
+        m_timer.setTimerType(Qt::VeryCoarseTimer);
+        delay = (delay + 999) / 1000 * 1000;
+    }
+    m_timer.start(int(delay));
+}
+
+void DeadlineScheduler::fire()
+{
+    TRACE_SCOPE("deadline", "fire");
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QVector<qint64> due;
+    while (!m_heap.isEmpty() && m_heap.first().due <= now) {
+        const qint64 id = m_heap.first().id;
+        due.append(id);
+
+        auto series = m_series.constFind(id);
+        const qint64 next = series != m_series.constEnd() ? nextDue(id, series->start, &series->rule, now) : -1;
+        if (next >= 0) {
+            setDue(id, next);
+        } else {
+            m_series.remove(id);
+            removeAt(0);
+        }
+    }
+
+    // Таймер мог проснуться раньше срока (ожидание частями) - тогда только перевзводится
+    m_armedDue = -1;
+    arm();
+    if (!due.isEmpty())
+        emit tasksDue(due);
+}
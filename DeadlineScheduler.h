@@ -0,0 +1,78 @@
+#ifndef DEADLINESCHEDULER_H
+#define DEADLINESCHEDULER_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QTimer>
+#include <QTime>
+#include <QDateTime>
+#include "Task.h"
+
+// Напоминания о сроках: ближайшие моменты напоминания лежат в двоичной
+// куче (минимум сверху) с индексом позиций по id, единственный QTimer
+// взведён на вершину кучи. Между сроками процессор не расходуется,
+// добавление, перенос и удаление задачи стоят O(log n).
+// Напоминание приходит в день срока в reminderTime; уже прошедшие
+// моменты не напоминаются. У повторяющейся задачи после срабатывания
+// ставится следующее повторение; отмеченные (выполненные или пропущенные)
+// дни повторений пропускаются.
+class DeadlineScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    explicit DeadlineScheduler(const QTime &reminderTime = QTime(9, 0), QObject *parent = nullptr);
+
+    // Заменяет все задачи; куча строится за O(n)
+    void setTasks(const QVector<Task> &tasks);
+    // Добавленная, перенесённая или отмеченная задача; выполненная и без срока снимается
+    void updateTask(const Task &task);
+    void removeTask(qint64 id);
+    void clear();
+
+    // Отмеченные дни повторений: заменяет все отметки / меняет одну
+    void setMarkedDays(const QHash<qint64, QSet<QDate>> &marked);
+    void setDayMarked(qint64 id, const QDate &day, bool marked);
+
+    int count() const { return m_heap.size(); }
+    // Ближайшее напоминание; невалидное, если напоминать нечего
+    QDateTime nextDeadline() const;
+
+signals:
+    // Задачи, срок которых наступил; одновременные приходят одним сигналом
+    void tasksDue(const QVector<qint64> &ids);
+
+private:
+    struct Entry {
+        qint64 due;     // мс от эпохи
+        qint64 id;
+    };
+    struct Series {
+        QDate start;
+        Recurrence rule;
+    };
+
+    // Ближайший момент напоминания позже now, -1 - напоминать нечего
+    qint64 nextDue(qint64 id, const QDate &date, const Recurrence *rule, qint64 now) const;
+    // Пересчёт срока повторяющейся задачи после смены её отметок
+    void reschedule(qint64 id);
+    qint64 deadlineOf(const QDate &date) const;
+    void setDue(qint64 id, qint64 due);
+    void removeAt(int index);
+    void siftUp(int index);
+    void siftDown(int index);
+    void place(int index, const Entry &entry);
+    void arm();
+    void fire();
+
+    QTime m_reminderTime;
+    QVector<Entry> m_heap;
+    QHash<qint64, int> m_positions;     // id -> индекс в куче
+    QHash<qint64, Series> m_series;     // повторяющиеся задачи из кучи
+    QHash<qint64, QSet<QDate>> m_marked; // отмеченные дни повторений по задачам
+    QTimer m_timer;
+    qint64 m_armedDue = -1;
+};
+
+#endif // DEADLINESCHEDULER_H
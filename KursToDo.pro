@@ -1,30 +1,9 @@
-QT       += core gui
-QT       += widgets
-QT       += core gui sql
-
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
-
-CONFIG += c++17
-
-# You can make your code fail to compile if it uses deprecated APIs.
-# In order to do so, uncomment the following line.
-#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
-
-SOURCES += \
-    DatabaseManager.cpp \
-    MainWindow.cpp \
-    main.cpp
-
-HEADERS += \
-    CalendarWidget.h \
-    DatabaseManager.h \
-    MainWindow.h \
-    NotesWidget.h \
-    TaskWidget.h
-
-FORMS +=
-
-# Default rules for deployment.
-qnx: target.path = /tmp/$${TARGET}/bin
-else: unix:!android: target.path = /opt/$${TARGET}/bin
-!isEmpty(target.path): INSTALLS += target
+TEMPLATE = subdirs
+
+# app        - само приложение
+# cli        - консольный импорт/экспорт без QtWidgets
+# benchmarks - микробенчмарки QtTest (QBENCHMARK) над теми же исходниками
+SUBDIRS += \
+    app \
+    cli \
+    benchmarks
@@ -4,11 +4,24 @@
 #include <QHBoxLayout>
 #include <QDockWidget>
 #include <QSizePolicy>
+#include <QTimer>
+#include <QSystemTrayIcon>
+#include <QStatusBar>
+#include <QStyle>
+#include <QApplication>
+#include "StartupTimer.h"
+#include "Theme.h"
+#include "Trace.h"
 
-MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
+MainWindow::MainWindow(AsyncDatabase *db, QWidget *parent) : QMainWindow(parent), db(db) {
+    TRACE_SCOPE("widget", "MainWindow");
     QWidget *centralWidget = new QWidget(this);
     setCentralWidget(centralWidget);
 
+    aggregates = new CalendarAggregates(db, this);
+    deadlines = new DeadlineScheduler(QTime(9, 0), this);
+    connect(deadlines, &DeadlineScheduler::tasksDue, this, &MainWindow::remindTasks);
+
     QWidget *sidePanel = new QWidget;
     sidePanel->setObjectName("SidePanel");
     QVBoxLayout *sideLayout = new QVBoxLayout;
@@ -18,25 +31,192 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
     taskButton = new QPushButton("📋 Tasks");
     calendarButton = new QPushButton("📅 Calendar");
     notesButton = new QPushButton("📝 Notes");
+    searchButton = new QPushButton("🔍 Search");
 
     sideLayout->addWidget(taskButton);
     sideLayout->addWidget(calendarButton);
     sideLayout->addWidget(notesButton);
+    sideLayout->addWidget(searchButton);
     sideLayout->addStretch();
+    themeButton = new QPushButton("🌓 Theme");
+    sideLayout->addWidget(themeButton);
     sidePanel->setLayout(sideLayout);
     sidePanel->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Expanding);
 
     stackedWidget = new QStackedWidget;
-    stackedWidget->addWidget(new TaskWidget);
-    stackedWidget->addWidget(new CalendarWidget);
-    stackedWidget->addWidget(new NotesWidget);
 
     QHBoxLayout *mainLayout = new QHBoxLayout;
     mainLayout->addWidget(sidePanel);
     mainLayout->addWidget(stackedWidget);
     centralWidget->setLayout(mainLayout);
 
-    connect(taskButton, &QPushButton::clicked, [=](){ stackedWidget->setCurrentIndex(0); });
-    connect(calendarButton, &QPushButton::clicked, [=](){ stackedWidget->setCurrentIndex(1); });
-    connect(notesButton, &QPushButton::clicked, [=](){ stackedWidget->setCurrentIndex(2); });
+    connect(taskButton, &QPushButton::clicked, [=](){ showPage(TasksPage); });
+    connect(calendarButton, &QPushButton::clicked, [=](){ showPage(CalendarPage); });
+    connect(notesButton, &QPushButton::clicked, [=](){ showPage(NotesPage); });
+    connect(searchButton, &QPushButton::clicked, [=](){ showPage(SearchPage); });
+    connect(themeButton, &QPushButton::clicked, [](){ Theme::instance()->toggle(); });
+}
+
+bool MainWindow::event(QEvent *event) {
+    const bool result = QMainWindow::event(event);
+    // Первый UpdateRequest - первая отрисовка окна; остальная работа
+    // откладывается до следующего прохода цикла событий
+    if (event->type() == QEvent::UpdateRequest && !firstFrame) {
+        firstFrame = true;
+        QTimer::singleShot(0, this, &MainWindow::firstFrameShown);
+    }
+    return result;
+}
+
+void MainWindow::firstFrameShown() {
+    StartupTimer::mark("first frame");
+    if (!stackedWidget->currentWidget())
+        showPage(TasksPage);
+}
+
+void MainWindow::remindTasks(const QVector<qint64> &ids) {
+    static constexpr int MaxListed = 5;
+
+    // Текст берётся из модели в момент напоминания, куча хранит только id;
+    // задачи, которых в модели уже нет, не считаются
+    TaskModel *model = taskPage()->model();
+    QStringList lines;
+    qint64 firstId = -1;
+    int found = 0;
+    for (qint64 id : ids) {
+        const int row = model->rowOfTask(id);
+        if (row < 0)
+            continue;
+        if (found++ == 0)
+            firstId = id;
+        if (lines.size() < MaxListed)
+            lines.append("⏰ " + model->taskAt(row).text);
+    }
+    if (found == 0)
+        return;
+    if (found > MaxListed)
+        lines.append(QString("...и ещё %1").arg(found - MaxListed));
+    remindedTaskId = firstId;
+
+    const QString title = found == 1 ? QString("Срок задачи") : QString("Сроки задач: %1").arg(found);
+    if (QSystemTrayIcon::isSystemTrayAvailable()) {
+        if (!trayIcon) {
+            trayIcon = new QSystemTrayIcon(windowIcon().isNull() ? style()->standardIcon(QStyle::SP_MessageBoxInformation)
+                                                                 : windowIcon(), this);
+            connect(trayIcon, &QSystemTrayIcon::messageClicked, this, [this]() {
+                showNormal();
+                activateWindow();
+                showPage(TasksPage);
+                taskPage()->showTask(remindedTaskId);
+            });
+            trayIcon->show();
+        }
+        trayIcon->showMessage(title, lines.join('\n'));
+    } else {
+        statusBar()->showMessage(title + ": " + lines.join("; "), 60 * 1000);
+    }
+    QApplication::alert(this);
+}
+
+void MainWindow::showPage(Page index) {
+    stackedWidget->setCurrentWidget(page(index));
+}
+
+QWidget *MainWindow::page(Page index) {
+    if (pages[index])
+        return pages[index];
+
+    static const char *const pageNames[PageCount] = {"tasks", "calendar", "notes", "search"};
+    TRACE_SCOPE_DETAIL("widget", "createPage", QString::fromLatin1(pageNames[index]));
+    QWidget *widget = nullptr;
+    switch (index) {
+    case TasksPage: {
+        TaskWidget *taskWidget = new TaskWidget(db);
+        connect(taskWidget, &TaskWidget::loadFinished, this, [this]() {
+            if (StartupTimer::isFinished())
+                return;
+            StartupTimer::finish("interactive");
+            // Фоновая уборка не задерживает запуск: вложения удалённых заметок
+            db->write([](DatabaseManager &m) {
+                return m.pruneBlobs();
+            });
+        });
+        // Расписание напоминаний строится по загруженному списку одним проходом,
+        // дальше изменения задач переставляют его записи по одной
+        connect(taskWidget, &TaskWidget::loadFinished, deadlines, [this, taskWidget]() {
+            QVector<Task> open;
+            taskWidget->model()->forEachTask([&open](const Task &task) {
+                if (!task.completed && task.date.isValid())
+                    open.append(task);
+            });
+            deadlines->setTasks(open);
+            // Отмеченные в календаре повторения (выполнено/пропущено) не напоминаются
+            db->read([](DatabaseManager &m) {
+                return m.markedOccurrences(QDate::currentDate());
+            }).then(deadlines, [this](const QHash<qint64, QSet<QDate>> &marked) {
+                deadlines->setMarkedDays(marked);
+            });
+        });
+        connect(taskWidget->model(), &TaskModel::tasksAdded, deadlines, [this](const QVector<Task> &tasks) {
+            for (const Task &task : tasks)
+                deadlines->updateTask(task);
+        });
+        connect(taskWidget->model(), &TaskModel::tasksUpdated, deadlines,
+                [this](const QVector<Task> &, const QVector<Task> &after) {
+            for (const Task &task : after)
+                deadlines->updateTask(task);
+        });
+        connect(taskWidget->model(), &TaskModel::tasksRemoved, deadlines, [this](const QVector<Task> &tasks) {
+            for (const Task &task : tasks)
+                deadlines->removeTask(task.id);
+        });
+        // Изменения задач обновляют кэш календаря разностями
+        connect(taskWidget->model(), &TaskModel::tasksAdded, aggregates, [this](const QVector<Task> &tasks) {
+            for (const Task &task : tasks)
+                aggregates->taskAdded(task);
+        });
+        connect(taskWidget->model(), &TaskModel::tasksUpdated, aggregates,
+                [this](const QVector<Task> &before, const QVector<Task> &after) {
+            for (int i = 0; i < after.size(); ++i)
+                aggregates->taskUpdated(before.at(i), after.at(i));
+        });
+        connect(taskWidget->model(), &TaskModel::tasksRemoved, aggregates, [this](const QVector<Task> &tasks) {
+            for (const Task &task : tasks)
+                aggregates->taskRemoved(task);
+        });
+        widget = taskWidget;
+        break;
+    }
+    case CalendarPage: {
+        CalendarWidget *calendarWidget = new CalendarWidget(db, aggregates);
+        connect(calendarWidget, &CalendarWidget::occurrenceMarked, deadlines,
+                [this](qint64 id, const QDate &day, DatabaseManager::OccurrenceState state) {
+            deadlines->setDayMarked(id, day, state != DatabaseManager::OccurrenceOpen);
+        });
+        widget = calendarWidget;
+        break;
+    }
+    case NotesPage:
+        widget = new NotesWidget(db);
+        break;
+    case SearchPage: {
+        SearchWidget *searchWidget = new SearchWidget(db);
+        connect(searchWidget, &SearchWidget::taskActivated, this, [=](qint64 id) {
+            showPage(TasksPage);
+            taskPage()->showTask(id);
+        });
+        connect(searchWidget, &SearchWidget::noteActivated, this, [=](qint64 id) {
+            showPage(NotesPage);
+            notesPage()->showNote(id);
+        });
+        widget = searchWidget;
+        break;
+    }
+    case PageCount:
+        break;
+    }
+
+    pages[index] = widget;
+    stackedWidget->addWidget(widget);
+    return widget;
 }
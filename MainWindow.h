@@ -9,18 +9,50 @@
 #include "TaskWidget.h"
 #include "CalendarWidget.h"
 #include "NotesWidget.h"
+#include "SearchWidget.h"
+#include "AsyncDatabase.h"
+#include "CalendarAggregates.h"
+#include "DeadlineScheduler.h"
+
+class QSystemTrayIcon;
 
 class MainWindow : public QMainWindow {
     Q_OBJECT
 
 public:
-    MainWindow(QWidget *parent = nullptr);
+    MainWindow(AsyncDatabase *db, QWidget *parent = nullptr);
+
+protected:
+    bool event(QEvent *event) override;
 
 private:
+    // Страницы создаются при первом переходе на них; стартовая -
+    // сразу после первого кадра, чтобы окно появилось без ожидания
+    enum Page { TasksPage, CalendarPage, NotesPage, SearchPage, PageCount };
+
+    void showPage(Page index);
+    QWidget *page(Page index);
+    TaskWidget *taskPage() { return static_cast<TaskWidget *>(page(TasksPage)); }
+    NotesWidget *notesPage() { return static_cast<NotesWidget *>(page(NotesPage)); }
+    void firstFrameShown();
+    void remindTasks(const QVector<qint64> &ids);
+
+    AsyncDatabase *db;
+    // Живёт дольше страниц: календарь может появиться позже списка задач
+    CalendarAggregates *aggregates;
+    // Напоминания о сроках, ведутся по сигналам модели задач
+    DeadlineScheduler *deadlines;
+    QSystemTrayIcon *trayIcon = nullptr;
+    qint64 remindedTaskId = -1;
+    QWidget *pages[PageCount] = {};
+    bool firstFrame = false;
+
     QStackedWidget *stackedWidget;
     QPushButton *taskButton;
     QPushButton *calendarButton;
     QPushButton *notesButton;
+    QPushButton *searchButton;
+    QPushButton *themeButton;
 };
 
 #endif // MAINWINDOW_H
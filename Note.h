@@ -0,0 +1,14 @@
+#ifndef NOTE_H
+#define NOTE_H
+
+#include <QString>
+#include <QtGlobal>
+
+// Заметка: HTML из редактора и его текст без разметки для поиска
+struct Note {
+    qint64 id = 0;
+    QString html;
+    QString plainText;
+};
+
+#endif // NOTE_H
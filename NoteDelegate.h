@@ -0,0 +1,249 @@
+#ifndef NOTEDELEGATE_H
+#define NOTEDELEGATE_H
+
+#include <QStyledItemDelegate>
+#include <QPainter>
+#include <QMouseEvent>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QTextEdit>
+#include <QPushButton>
+#include <QMessageBox>
+#include <QAbstractTextDocumentLayout>
+#include <QCache>
+#include <QSet>
+#include "NoteModel.h"
+#include "NoteImages.h"
+#include "Theme.h"
+#include "Trace.h"
+
+// Редактор заметки: создаётся только по кнопке ✏️ для одной карточки
+class NoteEditor : public QWidget {
+    Q_OBJECT
+public:
+    NoteEditor(NoteImageStore *images, QWidget *parent = nullptr) : QWidget(parent) {
+        QHBoxLayout *layout = new QHBoxLayout(this);
+        layout->setContentsMargins(0, 0, 0, 0);
+        layout->setSpacing(6);
+
+        textEdit = new QTextEdit;
+        textEdit->setDocument(new NoteDocument(images, textEdit));
+        layout->addWidget(textEdit);
+
+        QPushButton *saveBtn = new QPushButton("💾");
+        saveBtn->setFixedSize(30, 30);
+        layout->addWidget(saveBtn, 0, Qt::AlignBottom);
+
+        setFocusProxy(textEdit);
+        connect(saveBtn, &QPushButton::clicked, this, &NoteEditor::saveRequested);
+    }
+
+    QString html() const { return textEdit->toHtml(); }
+    QString plainText() const { return textEdit->toPlainText(); }
+    void setHtml(const QString &html) { textEdit->setHtml(html); }
+
+signals:
+    void saveRequested();
+
+private:
+    QTextEdit *textEdit;
+};
+
+// Рисует карточки заметок. Содержимое карточки - превью, отрисованное
+// в QPixmap один раз на ревизию заметки и ширину; отрисовываются только
+// видимые карточки, готовые превью хранятся в ограниченном кэше.
+class NoteDelegate : public QStyledItemDelegate {
+    Q_OBJECT
+public:
+    NoteDelegate(NoteImageStore *images, QObject *parent = nullptr)
+        : QStyledItemDelegate(parent), m_images(images), m_previews(32 * 1024) {
+        // Превью с заглушками вместо картинок перерисовываются, когда картинки готовы
+        connect(images, &NoteImageStore::imageReady, this, [this]() {
+            if (m_incomplete.isEmpty())
+                return;
+            for (quint64 revision : std::as_const(m_incomplete))
+                m_previews.remove(revision);
+            m_incomplete.clear();
+            emit previewsChanged();
+        });
+        // Превью нарисованы цветом текста прежней темы
+        connect(Theme::instance(), &Theme::changed, this, [this]() {
+            m_previews.clear();
+            m_incomplete.clear();
+            emit previewsChanged();
+        });
+    }
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override {
+        const CardGeometry g = geometry(option.rect);
+
+        painter->save();
+        painter->setRenderHint(QPainter::Antialiasing);
+
+        painter->setPen(Qt::NoPen);
+        painter->setBrush(Theme::instance()->color(
+            (option.state & QStyle::State_Selected) ? Theme::CardSelected : Theme::Card));
+        painter->drawRoundedRect(g.frame, 10, 10);
+
+        const qreal dpr = painter->device() ? painter->device()->devicePixelRatio() : 1.0;
+        painter->drawPixmap(g.content.topLeft(), preview(index, g.content.size(), dpr));
+
+        drawButton(painter, g.edit, "✏️");
+        drawButton(painter, g.open, "🔎");
+        drawButton(painter, g.history, "🕘");
+        drawButton(painter, g.remove, "❌");
+
+        painter->restore();
+    }
+
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override {
+        return QSize(QStyledItemDelegate::sizeHint(option, index).width(), CardHeight);
+    }
+
+    QWidget *createEditor(QWidget *parent, const QStyleOptionViewItem &, const QModelIndex &) const override {
+        NoteEditor *editor = new NoteEditor(m_images, parent);
+        connect(editor, &NoteEditor::saveRequested, this, &NoteDelegate::commitAndCloseEditor);
+        return editor;
+    }
+
+    void setEditorData(QWidget *editor, const QModelIndex &index) const override {
+        static_cast<NoteEditor *>(editor)->setHtml(index.data(NoteModel::HtmlRole).toString());
+    }
+
+    void setModelData(QWidget *editor, QAbstractItemModel *model, const QModelIndex &index) const override {
+        NoteEditor *noteEditor = static_cast<NoteEditor *>(editor);
+        if (!noteEditor->plainText().trimmed().isEmpty())
+            model->setData(index, noteEditor->html(), NoteModel::HtmlRole);
+    }
+
+    void updateEditorGeometry(QWidget *editor, const QStyleOptionViewItem &option, const QModelIndex &) const override {
+        editor->setGeometry(geometry(option.rect).frame.adjusted(8, 8, -8, -8));
+    }
+
+    bool editorEvent(QEvent *event, QAbstractItemModel *, const QStyleOptionViewItem &option,
+                     const QModelIndex &index) override {
+        if (event->type() != QEvent::MouseButtonRelease)
+            return false;
+
+        QMouseEvent *mouse = static_cast<QMouseEvent *>(event);
+        if (mouse->button() != Qt::LeftButton)
+            return false;
+
+        const CardGeometry g = geometry(option.rect);
+        const QPoint pos = mouse->position().toPoint();
+        if (g.edit.contains(pos)) {
+            emit editRequested(index);
+            return true;
+        }
+        if (g.open.contains(pos)) {
+            emit openRequested(index);
+            return true;
+        }
+        if (g.history.contains(pos)) {
+            emit historyRequested(index);
+            return true;
+        }
+        if (g.remove.contains(pos)) {
+            emit removeRequested(index);
+            return true;
+        }
+        return false;
+    }
+
+signals:
+    void editRequested(const QModelIndex &index);
+    void openRequested(const QModelIndex &index);
+    void removeRequested(const QModelIndex &index);
+    void historyRequested(const QModelIndex &index);
+    // Кэш превью сброшен, видимые карточки нужно перерисовать
+    void previewsChanged();
+
+private slots:
+    void commitAndCloseEditor() {
+        NoteEditor *editor = qobject_cast<NoteEditor *>(sender());
+        if (!editor)
+            return;
+        if (editor->plainText().trimmed().isEmpty()) {
+            QMessageBox::warning(editor, "Ошибка", "Нельзя сохранить пустую заметку.");
+            return;
+        }
+        emit commitData(editor);
+        emit closeEditor(editor);
+    }
+
+private:
+    static constexpr int CardHeight = 200;
+    static constexpr int ButtonSize = 30;
+
+    struct CardGeometry {
+        QRect frame;
+        QRect content;
+        QRect edit;
+        QRect open;
+        QRect history;
+        QRect remove;
+    };
+
+    static CardGeometry geometry(const QRect &rect) {
+        CardGeometry g;
+        g.frame = rect.adjusted(2, 4, -2, -4);
+        const QRect inner = g.frame.adjusted(12, 10, -12, -8);
+
+        g.edit = QRect(inner.left(), inner.bottom() - ButtonSize + 1, ButtonSize, ButtonSize);
+        g.open = g.edit.translated(ButtonSize + 6, 0);
+        g.history = g.open.translated(ButtonSize + 6, 0);
+        g.remove = QRect(inner.right() - ButtonSize + 1, g.edit.top(), ButtonSize, ButtonSize);
+        g.content = QRect(inner.topLeft(), QPoint(inner.right(), g.edit.top() - 8));
+        return g;
+    }
+
+    QPixmap preview(const QModelIndex &index, const QSize &size, qreal dpr) const {
+        const quint64 revision = index.data(NoteModel::RevisionRole).toULongLong();
+        if (QPixmap *cached = m_previews.object(revision)) {
+            if (cached->size() == size * dpr)
+                return *cached;
+        }
+
+        TRACE_SCOPE("paint", "NoteDelegate::preview");
+        NoteDocument doc(m_images);
+        doc.setDocumentMargin(0);
+        doc.setHtml(index.data(NoteModel::HtmlRole).toString());
+        doc.setTextWidth(size.width());
+
+        QPixmap pixmap(size * dpr);
+        pixmap.setDevicePixelRatio(dpr);
+        pixmap.fill(Qt::transparent);
+        {
+            QPainter painter(&pixmap);
+            QAbstractTextDocumentLayout::PaintContext context;
+            context.palette.setColor(QPalette::Text, Theme::instance()->color(Theme::Text));
+            context.clip = QRectF(0, 0, size.width(), size.height());
+            painter.setClipRect(context.clip);
+            doc.documentLayout()->draw(&painter, context);
+        }
+
+        if (doc.hasPendingImages())
+            m_incomplete.insert(revision);
+        m_previews.insert(revision, new QPixmap(pixmap),
+                          qMax<qsizetype>(1, qsizetype(pixmap.width()) * pixmap.height() * 4 / 1024));
+        return pixmap;
+    }
+
+    static void drawButton(QPainter *painter, const QRect &rect, const QString &label) {
+        painter->setPen(Qt::NoPen);
+        painter->setBrush(Theme::instance()->color(Theme::Accent));
+        painter->drawRoundedRect(rect, 8, 8);
+
+        QFont font = painter->font();
+        font.setPixelSize(14);
+        painter->setFont(font);
+        painter->setPen(Qt::white);
+        painter->drawText(rect, Qt::AlignCenter, label);
+    }
+
+    NoteImageStore *m_images;
+    mutable QCache<quint64, QPixmap> m_previews;   // по ревизии, стоимость - КиБ
+    mutable QSet<quint64> m_incomplete;            // ревизии, отрисованные с заглушками
+};
+
+#endif // NOTEDELEGATE_H
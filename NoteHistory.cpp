@@ -0,0 +1,155 @@
+#include "NoteHistory.h"
+
+#include <QHash>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+// Совпадения ищутся по блокам base с шагом BlockSize, поэтому находится
+// любой общий участок длиной от 2 * BlockSize - 1 байт
+constexpr int BlockSize = 16;
+
+enum Op : char { CopyOp = 'c', InsertOp = 'i' };
+
+void writeVarint(QByteArray &out, quint64 value)
+{
+    while (value >= 0x80) {
+        out.append(char(value | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+bool readVarint(const QByteArray &in, int &pos, quint64 *value)
+{
+    quint64 result = 0;
+    for (int shift = 0; shift < 64 && pos < in.size(); shift += 7) {
+        const uchar byte = uchar(in.at(pos++));
+        result |= quint64(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t blockHash(const char *data)
+{
+    return qHash(QByteArrayView(data, BlockSize));
+}
+
+} // namespace
+
+QByteArray NoteHistory::makeDelta(const QByteArray &base, const QByteArray &target)
+{
+    QHash<size_t, int> blocks;
+    blocks.reserve(base.size() / BlockSize);
+    for (int offset = 0; offset + BlockSize <= base.size(); offset += BlockSize) {
+        const size_t hash = blockHash(base.constData() + offset);
+        if (!blocks.contains(hash))
+            blocks.insert(hash, offset);
+    }
+
+    QByteArray delta;
+    writeVarint(delta, quint64(target.size()));
+
+    auto insert = [&](int from, int to) {
+        if (to <= from)
+            return;
+        delta.append(InsertOp);
+        writeVarint(delta, quint64(to - from));
+        delta.append(target.constData() + from, to - from);
+    };
+
+    const char *b = base.constData();
+    const char *t = target.constData();
+    int literal = 0;
+    int pos = 0;
+    while (pos + BlockSize <= target.size()) {
+        const auto it = blocks.constFind(blockHash(t + pos));
+        if (it == blocks.constEnd() || memcmp(b + it.value(), t + pos, BlockSize) != 0) {
+            ++pos;
+            continue;
+        }
+
+        // Совпадение расширяется назад (за счёт ещё не записанной вставки) и вперёд
+        int from = it.value();
+        int start = pos;
+        int length = BlockSize;
+        while (start > literal && from > 0 && b[from - 1] == t[start - 1]) {
+            --start;
+            --from;
+            ++length;
+        }
+        while (start + length < target.size() && from + length < base.size()
+               && b[from + length] == t[start + length])
+            ++length;
+
+        insert(literal, start);
+        delta.append(CopyOp);
+        writeVarint(delta, quint64(from));
+        writeVarint(delta, quint64(length));
+        pos = literal = start + length;
+    }
+    insert(literal, target.size());
+    return delta;
+}
+
+bool NoteHistory::applyDelta(const QByteArray &base, const QByteArray &delta, QByteArray *target)
+{
+    int pos = 0;
+    quint64 size = 0;
+    if (!readVarint(delta, pos, &size) || size > quint64(std::numeric_limits<int>::max()))
+        return false;
+
+    QByteArray result;
+    result.reserve(qsizetype(size));
+    while (pos < delta.size()) {
+        const char op = delta.at(pos++);
+        quint64 first = 0, second = 0;
+        if (op == CopyOp) {
+            if (!readVarint(delta, pos, &first) || !readVarint(delta, pos, &second)
+                || first + second > quint64(base.size()))
+                return false;
+            result.append(base.constData() + first, qsizetype(second));
+        } else if (op == InsertOp) {
+            if (!readVarint(delta, pos, &first) || first > quint64(delta.size() - pos))
+                return false;
+            result.append(delta.constData() + pos, qsizetype(first));
+            pos += int(first);
+        } else {
+            return false;
+        }
+        if (quint64(result.size()) > size)
+            return false;
+    }
+    if (quint64(result.size()) != size)
+        return false;
+
+    *target = result;
+    return true;
+}
+
+QByteArray NoteHistory::pack(const QByteArray &data, int threshold, int *flags)
+{
+    if (data.size() > threshold) {
+        const QByteArray compressed = qCompress(data);
+        if (compressed.size() < data.size()) {
+            *flags |= Compressed;
+            return compressed;
+        }
+    }
+    return data;
+}
+
+bool NoteHistory::unpack(const QByteArray &stored, int flags, QByteArray *data)
+{
+    if (!(flags & Compressed)) {
+        *data = stored;
+        return true;
+    }
+    *data = qUncompress(stored);
+    return !data->isEmpty();
+}
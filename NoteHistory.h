@@ -0,0 +1,46 @@
+#ifndef NOTEHISTORY_H
+#define NOTEHISTORY_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QtGlobal>
+
+// Ревизия заметки в списке истории
+struct NoteRevision {
+    qint64 noteId = 0;
+    int revision = 0;
+    QDateTime created;
+    int textSize = 0;       // размер HTML ревизии
+    int storedSize = 0;     // сколько она занимает в базе
+    bool keyframe = false;
+};
+
+// Хранение истории: каждые keyframeInterval ревизий - полный текст (ключевой кадр),
+// между ними - разность с предыдущей ревизией. Восстановление читает не больше
+// keyframeInterval записей. Хранятся последние keepRevisions ревизий
+// (и ключевой кадр, от которого восстанавливается самая старая из них).
+struct NoteHistoryPolicy {
+    int keyframeInterval = 16;
+    int keepRevisions = 100;
+    int compressThreshold = 256;    // данные длиннее сжимаются qCompress, если это выгодно
+};
+
+// Кодирование ревизий заметок
+class NoteHistory
+{
+public:
+    enum Flag {
+        Delta = 0x1,        // разность с предыдущей ревизией, иначе полный текст
+        Compressed = 0x2    // данные сжаты qCompress
+    };
+
+    // Разность base -> target: копирования совпадающих блоков base и вставки новых байт
+    static QByteArray makeDelta(const QByteArray &base, const QByteArray &target);
+    static bool applyDelta(const QByteArray &base, const QByteArray &delta, QByteArray *target);
+
+    // Сжимает данные длиннее threshold, если это уменьшает их; выставляет Compressed во flags
+    static QByteArray pack(const QByteArray &data, int threshold, int *flags);
+    static bool unpack(const QByteArray &stored, int flags, QByteArray *data);
+};
+
+#endif // NOTEHISTORY_H
@@ -0,0 +1,99 @@
+#include "NoteImages.h"
+#include "AsyncDatabase.h"
+#include "Trace.h"
+
+#include <QBuffer>
+#include <QImageReader>
+#include <QThreadPool>
+#include <QColor>
+
+static const QString BlobScheme = QStringLiteral("blob");
+
+NoteImageStore::NoteImageStore(AsyncDatabase *db, QObject *parent)
+    : QObject(parent), m_db(db), m_cache(64 * 1024)
+{
+    m_placeholder = QImage(m_thumbnailWidth, m_thumbnailWidth * 3 / 4, QImage::Format_RGB32);
+    m_placeholder.fill(QColor("#3a3a3a"));
+}
+
+QUrl NoteImageStore::urlForBlob(qint64 id)
+{
+    return QUrl(BlobScheme + ':' + QString::number(id));
+}
+
+qint64 NoteImageStore::blobIdFromUrl(const QUrl &url)
+{
+    if (url.scheme() != BlobScheme)
+        return -1;
+    bool ok = false;
+    const qint64 id = url.path().toLongLong(&ok);
+    return ok ? id : -1;
+}
+
+QImage NoteImageStore::image(qint64 id)
+{
+    if (QImage *cached = m_cache.object(id))
+        return *cached;
+    if (m_pending.contains(id))
+        return QImage();
+    m_pending.insert(id);
+
+    const int width = m_thumbnailWidth;
+    m_db->read([id](DatabaseManager &m) {
+        return m.blobData(id);
+    }).then(QThreadPool::globalInstance(), [width](const QByteArray &data) {
+        return decodeThumbnail(data, width);
+    }).then(this, [this, id](const QImage &image) {
+        // Хранилище удалено раньше, чем закончилось декодирование - продолжение не вызывается
+        m_pending.remove(id);
+        if (image.isNull()) {
+            qWarning() << "Failed to decode blob image" << id;
+        } else {
+            m_cache.insert(id, new QImage(image), qMax<qsizetype>(1, image.sizeInBytes() / 1024));
+        }
+        emit imageReady(id, image.isNull() ? m_placeholder : image);
+    });
+    return QImage();
+}
+
+QImage NoteImageStore::decodeThumbnail(const QByteArray &data, int width)
+{
+    TRACE_SCOPE_DETAIL("image", "decodeThumbnail", QString::number(data.size()));
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+
+    // Декодер сразу выдаёт уменьшенное изображение, полный размер
+    // в памяти не появляется (для JPEG - масштабирование при декодировании)
+    QImageReader reader(&buffer);
+    reader.setAutoTransform(true);
+    const QSize size = reader.size();
+    if (size.isValid() && size.width() > width)
+        reader.setScaledSize(QSize(width, qMax(1, int(qint64(size.height()) * width / size.width()))));
+    return reader.read();
+}
+
+NoteDocument::NoteDocument(NoteImageStore *images, QObject *parent)
+    : QTextDocument(parent), m_images(images)
+{
+    connect(images, &NoteImageStore::imageReady, this, [this](qint64 id, const QImage &image) {
+        if (!m_waiting.remove(id))
+            return;
+        // Заглушка уже закэширована документом: подменяем ресурс и перекладываем текст
+        addResource(QTextDocument::ImageResource, NoteImageStore::urlForBlob(id), image);
+        markContentsDirty(0, characterCount());
+    });
+}
+
+QVariant NoteDocument::loadResource(int type, const QUrl &name)
+{
+    const qint64 blobId = NoteImageStore::blobIdFromUrl(name);
+    if (type != QTextDocument::ImageResource || blobId < 0)
+        return QTextDocument::loadResource(type, name);
+
+    const QImage image = m_images->image(blobId);
+    if (!image.isNull())
+        return image;
+    m_waiting.insert(blobId);
+    return m_images->placeholder();
+}
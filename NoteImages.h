@@ -0,0 +1,67 @@
+#ifndef NOTEIMAGES_H
+#define NOTEIMAGES_H
+
+#include <QObject>
+#include <QTextDocument>
+#include <QCache>
+#include <QSet>
+#include <QImage>
+#include <QUrl>
+
+class AsyncDatabase;
+
+// Изображения заметок из таблицы Blobs по адресам blob:<id>.
+// Вложение читается на потоке базы и декодируется в общем пуле потоков сразу
+// до размера миниатюры (QImageReader::setScaledSize); готовые миниатюры
+// лежат в общем LRU-кэше, ограниченном по объёму.
+class NoteImageStore : public QObject
+{
+    Q_OBJECT
+public:
+    explicit NoteImageStore(AsyncDatabase *db, QObject *parent = nullptr);
+
+    static QUrl urlForBlob(qint64 id);
+    // -1, если адрес не указывает на вложение
+    static qint64 blobIdFromUrl(const QUrl &url);
+
+    // Готовая миниатюра или пустое изображение; в последнем случае
+    // запускается декодирование и позже придёт imageReady
+    QImage image(qint64 id);
+    QImage placeholder() const { return m_placeholder; }
+
+    void setCacheLimit(qint64 bytes) { m_cache.setMaxCost(int(bytes / 1024)); }
+
+signals:
+    void imageReady(qint64 id, const QImage &image);
+
+private:
+    static QImage decodeThumbnail(const QByteArray &data, int width);
+
+    AsyncDatabase *m_db;
+    QCache<qint64, QImage> m_cache;     // стоимость - КиБ пикселей
+    QSet<qint64> m_pending;
+    QImage m_placeholder;
+    // Карточки показывают картинки шириной 200, запас на экраны с масштабом 2x
+    int m_thumbnailWidth = 400;
+};
+
+// Документ заметки, разрешающий адреса blob:<id> через NoteImageStore.
+// Пока миниатюра не готова, показывается заглушка.
+class NoteDocument : public QTextDocument
+{
+    Q_OBJECT
+public:
+    NoteDocument(NoteImageStore *images, QObject *parent = nullptr);
+
+    // Есть картинки, вместо которых пока нарисована заглушка
+    bool hasPendingImages() const { return !m_waiting.isEmpty(); }
+
+protected:
+    QVariant loadResource(int type, const QUrl &name) override;
+
+private:
+    NoteImageStore *m_images;
+    QSet<qint64> m_waiting;
+};
+
+#endif // NOTEIMAGES_H
@@ -0,0 +1,119 @@
+#ifndef NOTEMODEL_H
+#define NOTEMODEL_H
+
+#include <QAbstractListModel>
+#include <QTextDocument>
+#include <QVector>
+#include "Note.h"
+
+// Список заметок для QListView: карточки рисует NoteDelegate.
+// У каждой заметки есть ревизия, меняющаяся при каждом изменении
+// содержимого, - по ней делегат кэширует отрисованное превью.
+class NoteModel : public QAbstractListModel {
+    Q_OBJECT
+public:
+    enum Roles {
+        HtmlRole = Qt::UserRole + 1,
+        PlainTextRole,
+        IdRole,
+        RevisionRole
+    };
+
+    explicit NoteModel(QObject *parent = nullptr) : QAbstractListModel(parent) {}
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override {
+        return parent.isValid() ? 0 : m_notes.size();
+    }
+
+    QVariant data(const QModelIndex &index, int role) const override {
+        if (!index.isValid() || index.row() >= m_notes.size())
+            return QVariant();
+
+        const Note &note = m_notes.at(index.row());
+        switch (role) {
+        case Qt::DisplayRole:
+        case PlainTextRole:
+            return note.plainText;
+        case Qt::EditRole:
+        case HtmlRole:
+            return note.html;
+        case IdRole:
+            return note.id;
+        case RevisionRole:
+            return m_revisions.at(index.row());
+        default:
+            return QVariant();
+        }
+    }
+
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override {
+        if (!index.isValid() || index.row() >= m_notes.size())
+            return false;
+        if (role != Qt::EditRole && role != HtmlRole)
+            return false;
+
+        Note &note = m_notes[index.row()];
+        const QString html = value.toString();
+        if (html == note.html)
+            return false;
+
+        QTextDocument doc;
+        doc.setHtml(html);
+        note.html = html;
+        note.plainText = doc.toPlainText();
+        m_revisions[index.row()] = ++m_lastRevision;
+
+        emit dataChanged(index, index);
+        emit noteUpdated(note);
+        return true;
+    }
+
+    Qt::ItemFlags flags(const QModelIndex &index) const override {
+        if (!index.isValid())
+            return Qt::NoItemFlags;
+        return Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsEditable;
+    }
+
+    bool removeRows(int row, int count, const QModelIndex &parent = QModelIndex()) override {
+        if (parent.isValid() || row < 0 || count <= 0 || row + count > m_notes.size())
+            return false;
+
+        const QVector<Note> removed = m_notes.mid(row, count);
+        beginRemoveRows(QModelIndex(), row, row + count - 1);
+        m_notes.remove(row, count);
+        m_revisions.remove(row, count);
+        endRemoveRows();
+        emit notesRemoved(removed);
+        return true;
+    }
+
+    // Заметки, уже сохранённые в базе: вставка без сигналов для хранилища
+    void appendNotes(const QVector<Note> &notes) {
+        if (notes.isEmpty())
+            return;
+        beginInsertRows(QModelIndex(), m_notes.size(), m_notes.size() + notes.size() - 1);
+        m_notes.append(notes);
+        for (int i = 0; i < notes.size(); ++i)
+            m_revisions.append(++m_lastRevision);
+        endInsertRows();
+    }
+
+    int rowOfNote(qint64 id) const {
+        for (int row = 0; row < m_notes.size(); ++row) {
+            if (m_notes.at(row).id == id)
+                return row;
+        }
+        return -1;
+    }
+
+signals:
+    void noteUpdated(const Note &note);
+    void notesRemoved(const QVector<Note> &notes);
+
+private:
+    QVector<Note> m_notes;
+    QVector<quint64> m_revisions;
+    quint64 m_lastRevision = 0;
+};
+
+#endif // NOTEMODEL_H
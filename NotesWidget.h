@@ -7,39 +7,38 @@
 #include <QLineEdit>
 #include <QPushButton>
 #include <QTextEdit>
-#include <QScrollArea>
+#include <QListView>
 #include <QFileDialog>
 #include <QMessageBox>
-#include <QFrame>
 #include <QDialog>
 #include <QTextBrowser>
 #include <QTextCursor>
 #include <QTextListFormat>
 #include <QTextDocument>
+#include <QListWidget>
+#include <memory>
+#include "AsyncDatabase.h"
+#include "NoteImages.h"
+#include "NoteModel.h"
+#include "NoteDelegate.h"
 
 class NotesWidget : public QWidget {
     Q_OBJECT
 public:
-    NotesWidget(QWidget *parent = nullptr) : QWidget(parent) {
+    NotesWidget(AsyncDatabase *db, QWidget *parent = nullptr) : QWidget(parent), db(db) {
         QVBoxLayout *mainLayout = new QVBoxLayout(this);
+        images = new NoteImageStore(db, this);
 
         // Заголовок
         QLabel *title = new QLabel("📝 Заметки");
         title->setAlignment(Qt::AlignCenter);
-        title->setStyleSheet("font-size: 24px; font-weight: bold;");
+        title->setProperty("role", "pageTitle");
         mainLayout->addWidget(title);
 
         // Поле ввода
         noteInput = new QTextEdit;
+        noteInput->setDocument(new NoteDocument(images, noteInput));
         noteInput->setPlaceholderText("Введите текст заметки...");
-        noteInput->setStyleSheet(
-            "background-color: #1e1e1e;"
-            "color: white;"
-            "font-size: 16px;"
-            "border: 1px solid #555;"
-            "border-radius: 8px;"
-            "padding: 8px;"
-            );
         noteInput->setFixedHeight(80);
         mainLayout->addWidget(noteInput);
 
@@ -52,27 +51,77 @@ public:
         buttonLayout->addWidget(addNoteBtn);
         mainLayout->addLayout(buttonLayout);
 
-        // Область карточек заметок
-        scrollArea = new QScrollArea;
-        scrollArea->setWidgetResizable(true);
-        QWidget *container = new QWidget;
-        noteLayout = new QVBoxLayout(container);
-        noteLayout->setAlignment(Qt::AlignTop);
-        container->setLayout(noteLayout);
-        scrollArea->setWidget(container);
-        mainLayout->addWidget(scrollArea);
+        // Карточки заметок: модель + делегат, карточка рисуется из кэшированного
+        // превью, редактор создаётся только для редактируемой заметки
+        noteModel = new NoteModel(this);
+        NoteDelegate *delegate = new NoteDelegate(images, this);
+
+        noteView = new QListView;
+        noteView->setModel(noteModel);
+        noteView->setItemDelegate(delegate);
+        noteView->setUniformItemSizes(true);
+        noteView->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+        noteView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+        noteView->setSelectionMode(QAbstractItemView::SingleSelection);
+        mainLayout->addWidget(noteView);
+
+        connect(delegate, &NoteDelegate::editRequested, noteView, [this](const QModelIndex &index) {
+            noteView->edit(index);
+        });
+        connect(delegate, &NoteDelegate::openRequested, this, &NotesWidget::openNote);
+        connect(delegate, &NoteDelegate::historyRequested, this, &NotesWidget::openHistory);
+        connect(delegate, &NoteDelegate::removeRequested, this, [this](const QModelIndex &index) {
+            noteModel->removeRow(index.row());
+        });
+        connect(delegate, &NoteDelegate::previewsChanged, noteView->viewport(), [this]() {
+            noteView->viewport()->update();
+        });
+
+        connect(noteModel, &NoteModel::noteUpdated, this, [this](const Note &note) {
+            this->db->write([note](DatabaseManager &m) {
+                return m.updateNote(note.id, note.html, note.plainText);
+            });
+        });
+        connect(noteModel, &NoteModel::notesRemoved, this, [this](const QVector<Note> &removed) {
+            for (const Note &note : removed) {
+                const qint64 id = note.id;
+                this->db->write([id](DatabaseManager &m) {
+                    return m.deleteNote(id);
+                });
+            }
+        });
 
         // Подключения
         connect(addImageBtn, &QPushButton::clicked, this, &NotesWidget::attachImage);
         connect(addBulletBtn, &QPushButton::clicked, this, &NotesWidget::addBulletedList);
         connect(addNoteBtn, &QPushButton::clicked, this, &NotesWidget::addNote);
+
+        loadNotes();
+    }
+
+    // Прокрутка к карточке заметки (например, из результатов поиска);
+    // во время загрузки откладывается до её окончания
+    void showNote(qint64 id) {
+        if (loading) {
+            pendingShowId = id;
+            return;
+        }
+        const int row = noteModel->rowOfNote(id);
+        if (row < 0)
+            return;
+        const QModelIndex index = noteModel->index(row);
+        noteView->setCurrentIndex(index);
+        noteView->scrollTo(index, QAbstractItemView::PositionAtCenter);
     }
 
 private:
+    AsyncDatabase *db;
+    NoteImageStore *images;
     QTextEdit *noteInput;
-    QScrollArea *scrollArea;
-    QVBoxLayout *noteLayout;
-    QStringList attachedImages;
+    NoteModel *noteModel;
+    QListView *noteView;
+    bool loading = false;
+    qint64 pendingShowId = -1;
 
     void attachImage() {
         QString fileName = QFileDialog::getOpenFileName(this, "Выберите изображение", "", "Images (*.png *.jpg *.jpeg)");
@@ -82,8 +131,22 @@ private:
                 QMessageBox::warning(this, "Ошибка", "Файл превышает 5 МБ");
                 return;
             }
-            attachedImages.append(fileName);
-            noteInput->append("<img src='" + fileName + "' width='200' />");
+            if (!file.open(QIODevice::ReadOnly)) {
+                QMessageBox::warning(this, "Ошибка", "Не удалось открыть файл");
+                return;
+            }
+
+            // Файл копируется в базу, заметка ссылается на вложение по id
+            const QByteArray data = file.readAll();
+            db->write([data](DatabaseManager &m) {
+                return m.storeBlob(data);
+            }).then(this, [this](qint64 blobId) {
+                if (blobId < 0) {
+                    QMessageBox::warning(this, "Ошибка", "Не удалось сохранить изображение.");
+                    return;
+                }
+                noteInput->append("<img src='" + NoteImageStore::urlForBlob(blobId).toString() + "' width='200' />");
+            });
         }
     }
 
@@ -107,75 +170,130 @@ private:
             return;
         }
 
-        // Создание карточки
-        QFrame *noteFrame = new QFrame;
-        noteFrame->setFrameShape(QFrame::Box);
-        noteFrame->setStyleSheet("background-color: #2e2e2e; border-radius: 10px; padding: 8px;");
-        QVBoxLayout *frameLayout = new QVBoxLayout(noteFrame);
-        frameLayout->setSpacing(4);
-
-        QTextEdit *noteContent = new QTextEdit;
-        noteContent->setHtml(html);
-        noteContent->setReadOnly(true);
-        noteContent->setStyleSheet("background-color: #2e2e2e; color: white; border: none;");
-        noteContent->setMinimumHeight(120);
-        noteContent->setMaximumHeight(200);
-        frameLayout->addWidget(noteContent);
-
-        QHBoxLayout *actionLayout = new QHBoxLayout;
-
-        QPushButton *editBtn = new QPushButton("✏️");
-        QPushButton *saveBtn = new QPushButton("💾");
-        QPushButton *openBtn = new QPushButton("🔎");
-        QPushButton *deleteBtn = new QPushButton("❌");
-
-        saveBtn->setEnabled(false);
-
-        actionLayout->addWidget(editBtn);
-        actionLayout->addWidget(saveBtn);
-        actionLayout->addWidget(openBtn);
-        actionLayout->addStretch();
-        actionLayout->addWidget(deleteBtn);
-        frameLayout->addLayout(actionLayout);
-
-        noteLayout->addWidget(noteFrame);
-
-        connect(editBtn, &QPushButton::clicked, this, [=]() {
-            noteContent->setReadOnly(false);
-            saveBtn->setEnabled(true);
-            noteContent->setFocus();
+        Note note;
+        note.html = html;
+        note.plainText = plainText;
+        db->write([note](DatabaseManager &m) {
+            return m.addNote(note.html, note.plainText);
+        }).then(this, [this, note](qint64 id) mutable {
+            if (id < 0) {
+                QMessageBox::warning(this, "Ошибка", "Не удалось сохранить заметку.");
+                return;
+            }
+            note.id = id;
+            noteModel->appendNotes({note});
         });
 
-        connect(saveBtn, &QPushButton::clicked, this, [=]() {
-            noteContent->setReadOnly(true);
-            saveBtn->setEnabled(false);
-        });
+        noteInput->clear();
+    }
 
-        connect(deleteBtn, &QPushButton::clicked, this, [=]() {
-            noteLayout->removeWidget(noteFrame);
-            noteFrame->deleteLater();
+    void loadNotes() {
+        loading = true;
+        db->read([](DatabaseManager &m) {
+            return m.getAllNotes();
+        }).then(this, [this](const QVector<Note> &notes) {
+            noteModel->appendNotes(notes);
+            loading = false;
+            if (pendingShowId >= 0) {
+                showNote(pendingShowId);
+                pendingShowId = -1;
+            }
         });
+    }
+
+    void openNote(const QModelIndex &index) {
+        QDialog *dialog = new QDialog(this);
+        dialog->setAttribute(Qt::WA_DeleteOnClose);
+        dialog->setWindowTitle("Просмотр заметки");
+        dialog->resize(800, 600);
+
+        QVBoxLayout *dialogLayout = new QVBoxLayout(dialog);
+        QTextBrowser *browser = new QTextBrowser;
+        browser->setDocument(new NoteDocument(images, browser));
+        browser->setHtml(index.data(NoteModel::HtmlRole).toString());
+        dialogLayout->addWidget(browser);
+
+        QPushButton *closeBtn = new QPushButton("Закрыть");
+        connect(closeBtn, &QPushButton::clicked, dialog, &QDialog::accept);
+        dialogLayout->addWidget(closeBtn);
+
+        dialog->exec();
+    }
 
-        connect(openBtn, &QPushButton::clicked, this, [=]() {
-            QDialog *dialog = new QDialog(this);
-            dialog->setWindowTitle("Просмотр заметки");
-            dialog->resize(800, 600);
+    // История правок: список ревизий, просмотр выбранной и возврат к ней
+    // (возврат сохраняется как новая ревизия)
+    void openHistory(const QModelIndex &index) {
+        const qint64 noteId = index.data(NoteModel::IdRole).toLongLong();
 
-            QVBoxLayout *dialogLayout = new QVBoxLayout(dialog);
-            QTextBrowser *browser = new QTextBrowser;
-            browser->setHtml(noteContent->toHtml());
-            browser->setStyleSheet("background-color: #1e1e1e; color: white;");
-            dialogLayout->addWidget(browser);
+        QDialog *dialog = new QDialog(this);
+        dialog->setAttribute(Qt::WA_DeleteOnClose);
+        dialog->setWindowTitle("История заметки");
+        dialog->resize(900, 600);
 
-            QPushButton *closeBtn = new QPushButton("Закрыть");
-            connect(closeBtn, &QPushButton::clicked, dialog, &QDialog::accept);
-            dialogLayout->addWidget(closeBtn);
+        QHBoxLayout *dialogLayout = new QHBoxLayout(dialog);
+        QListWidget *revisionList = new QListWidget;
+        revisionList->setFixedWidth(260);
+        dialogLayout->addWidget(revisionList);
 
-            dialog->exec();
+        QVBoxLayout *previewLayout = new QVBoxLayout;
+        QTextBrowser *browser = new QTextBrowser;
+        browser->setDocument(new NoteDocument(images, browser));
+        previewLayout->addWidget(browser);
+
+        QHBoxLayout *buttonLayout = new QHBoxLayout;
+        QPushButton *restoreBtn = new QPushButton("↩ Восстановить эту версию");
+        restoreBtn->setEnabled(false);
+        QPushButton *closeBtn = new QPushButton("Закрыть");
+        buttonLayout->addWidget(restoreBtn);
+        buttonLayout->addWidget(closeBtn);
+        previewLayout->addLayout(buttonLayout);
+        dialogLayout->addLayout(previewLayout, 1);
+
+        auto shownHtml = std::make_shared<QString>();
+        connect(revisionList, &QListWidget::currentItemChanged, browser,
+                [this, noteId, browser, restoreBtn, revisionList, shownHtml](QListWidgetItem *item) {
+            restoreBtn->setEnabled(false);
+            if (!item)
+                return;
+            const int revision = item->data(Qt::UserRole).toInt();
+            db->read([noteId, revision](DatabaseManager &m) {
+                return m.noteRevisionText(noteId, revision);
+            }).then(browser, [browser, restoreBtn, revisionList, shownHtml, revision](const QString &html) {
+                // Пока версия читалась, выбрали другую
+                QListWidgetItem *current = revisionList->currentItem();
+                if (!current || current->data(Qt::UserRole).toInt() != revision)
+                    return;
+                *shownHtml = html;
+                browser->setHtml(html.isEmpty() ? QString("<i>Версия недоступна</i>") : html);
+                restoreBtn->setEnabled(!html.isEmpty());
+            });
+        });
+        connect(restoreBtn, &QPushButton::clicked, dialog, [this, noteId, shownHtml, dialog]() {
+            const int row = noteModel->rowOfNote(noteId);
+            if (row >= 0 && !shownHtml->isEmpty())
+                noteModel->setData(noteModel->index(row), *shownHtml, NoteModel::HtmlRole);
+            dialog->accept();
         });
+        connect(closeBtn, &QPushButton::clicked, dialog, &QDialog::reject);
 
-        noteInput->clear();
-        attachedImages.clear();
+        // Список читается через писателя: в нём уже есть только что сохранённая правка
+        db->write([noteId](DatabaseManager &m) {
+            return m.noteRevisions(noteId);
+        }).then(revisionList, [revisionList](const QVector<NoteRevision> &revisions) {
+            for (const NoteRevision &revision : revisions) {
+                QListWidgetItem *item = new QListWidgetItem(QString("Версия %1 - %2")
+                    .arg(revision.revision).arg(revision.created.toString("dd.MM.yyyy HH:mm")));
+                item->setData(Qt::UserRole, revision.revision);
+                item->setToolTip(QString("%1 байт, в базе %2 байт%3")
+                    .arg(revision.textSize).arg(revision.storedSize)
+                    .arg(revision.keyframe ? ", полный текст" : ", изменения"));
+                revisionList->addItem(item);
+            }
+            if (revisionList->count() > 0)
+                revisionList->setCurrentRow(0);
+        });
+
+        dialog->exec();
     }
 };
 
@@ -0,0 +1,236 @@
+#include "Recurrence.h"
+
+#include <QStringList>
+#include <algorithm>
+
+namespace {
+
+const char *const DayCodes[] = {"MO", "TU", "WE", "TH", "FR", "SA", "SU"};
+const char *const DayNames[] = {"пн", "вт", "ср", "чт", "пт", "сб", "вс"};
+
+// Понедельник недели, в которую попадает date
+QDate weekStart(const QDate &date)
+{
+    return date.addDays(1 - date.dayOfWeek());
+}
+
+int monthsBetween(const QDate &from, const QDate &to)
+{
+    return (to.year() - from.year()) * 12 + to.month() - from.month();
+}
+
+} // namespace
+
+Recurrence Recurrence::parse(const QString &rule)
+{
+    Recurrence result;
+    Recurrence invalid;
+    const QStringList parts = rule.trimmed().toUpper().split(';', Qt::SkipEmptyParts);
+    for (const QString &part : parts) {
+        const qsizetype eq = part.indexOf('=');
+        if (eq <= 0)
+            return invalid;
+        const QString key = part.left(eq).trimmed();
+        const QString value = part.mid(eq + 1).trimmed();
+        bool ok = true;
+        if (key == "FREQ") {
+            if (value == "DAILY") result.m_frequency = Daily;
+            else if (value == "WEEKLY") result.m_frequency = Weekly;
+            else if (value == "MONTHLY") result.m_frequency = Monthly;
+            else if (value == "YEARLY") result.m_frequency = Yearly;
+            else return invalid;
+        } else if (key == "INTERVAL") {
+            result.m_interval = value.toInt(&ok);
+            if (!ok || result.m_interval < 1)
+                return invalid;
+        } else if (key == "COUNT") {
+            result.m_count = value.toInt(&ok);
+            if (!ok || result.m_count < 1)
+                return invalid;
+        } else if (key == "UNTIL") {
+            result.m_until = QDate::fromString(value.left(8), "yyyyMMdd");
+            if (!result.m_until.isValid())
+                return invalid;
+        } else if (key == "BYDAY") {
+            for (const QString &code : value.split(',', Qt::SkipEmptyParts)) {
+                const auto it = std::find_if(std::begin(DayCodes), std::end(DayCodes), [&code](const char *day) {
+                    return code.trimmed() == QLatin1String(day);
+                });
+                if (it == std::end(DayCodes))
+                    return invalid;
+                const int day = int(it - std::begin(DayCodes)) + 1;
+                if (!result.m_byDay.contains(day))
+                    result.m_byDay.append(day);
+            }
+            std::sort(result.m_byDay.begin(), result.m_byDay.end());
+        } else if (key == "BYMONTHDAY") {
+            result.m_byMonthDay = value.toInt(&ok);
+            if (!ok || result.m_byMonthDay == 0 || result.m_byMonthDay > 31 || result.m_byMonthDay < -1)
+                return invalid;
+        } else {
+            return invalid;
+        }
+    }
+
+    if ((!result.m_byDay.isEmpty() && result.m_frequency != Weekly)
+        || (result.m_byMonthDay != 0 && result.m_frequency != Monthly))
+        return invalid;
+    return result;
+}
+
+QString Recurrence::toString() const
+{
+    static const char *const frequencies[] = {"", "DAILY", "WEEKLY", "MONTHLY", "YEARLY"};
+    if (!isValid())
+        return QString();
+
+    QStringList parts{QString("FREQ=%1").arg(frequencies[m_frequency])};
+    if (m_interval > 1)
+        parts << QString("INTERVAL=%1").arg(m_interval);
+    if (!m_byDay.isEmpty()) {
+        QStringList days;
+        for (int day : m_byDay)
+            days << DayCodes[day - 1];
+        parts << "BYDAY=" + days.join(',');
+    }
+    if (m_byMonthDay != 0)
+        parts << QString("BYMONTHDAY=%1").arg(m_byMonthDay);
+    if (m_count > 0)
+        parts << QString("COUNT=%1").arg(m_count);
+    if (m_until.isValid())
+        parts << "UNTIL=" + m_until.toString("yyyyMMdd");
+    return parts.join(';');
+}
+
+QString Recurrence::describe() const
+{
+    QString text;
+    switch (m_frequency) {
+    case None:
+        return QString();
+    case Daily:
+        text = m_interval > 1 ? QString("каждые %1 дн.").arg(m_interval) : QString("каждый день");
+        break;
+    case Weekly:
+        text = m_interval > 1 ? QString("каждые %1 нед.").arg(m_interval) : QString("каждую неделю");
+        break;
+    case Monthly:
+        text = m_interval > 1 ? QString("каждые %1 мес.").arg(m_interval) : QString("каждый месяц");
+        break;
+    case Yearly:
+        text = m_interval > 1 ? QString("каждые %1 г.").arg(m_interval) : QString("каждый год");
+        break;
+    }
+    if (!m_byDay.isEmpty()) {
+        QStringList days;
+        for (int day : m_byDay)
+            days << DayNames[day - 1];
+        text += " (" + days.join(", ") + ")";
+    }
+    if (m_byMonthDay == -1)
+        text += ", в последний день";
+    else if (m_byMonthDay > 0)
+        text += QString(", %1-го числа").arg(m_byMonthDay);
+    if (m_count > 0)
+        text += QString(", %1 раз").arg(m_count);
+    if (m_until.isValid())
+        text += ", до " + m_until.toString("dd.MM.yyyy");
+    return text;
+}
+
+QDate Recurrence::periodStart(const QDate &start, qint64 number) const
+{
+    switch (m_frequency) {
+    case Daily:
+        return start.addDays(number * m_interval);
+    case Weekly:
+        return weekStart(start).addDays(number * m_interval * 7);
+    case Monthly:
+        return QDate(start.year(), start.month(), 1).addMonths(int(number * m_interval));
+    case Yearly:
+        return QDate(start.year(), 1, 1).addYears(int(number * m_interval));
+    case None:
+        break;
+    }
+    return QDate();
+}
+
+QVector<QDate> Recurrence::periodDates(const QDate &start, qint64 number) const
+{
+    QVector<QDate> dates;
+    const QDate base = periodStart(start, number);
+    switch (m_frequency) {
+    case Daily:
+        dates.append(base);
+        break;
+    case Weekly:
+        if (m_byDay.isEmpty()) {
+            dates.append(base.addDays(start.dayOfWeek() - 1));
+        } else {
+            for (int day : m_byDay)
+                dates.append(base.addDays(day - 1));
+        }
+        break;
+    case Monthly: {
+        // Несуществующее число (31 апреля) пропускается, как в RFC 5545
+        const int day = m_byMonthDay == -1 ? base.daysInMonth() : (m_byMonthDay > 0 ? m_byMonthDay : start.day());
+        if (day <= base.daysInMonth())
+            dates.append(QDate(base.year(), base.month(), day));
+        break;
+    }
+    case Yearly: {
+        const QDate date(base.year(), start.month(), start.day());
+        if (date.isValid())
+            dates.append(date);
+        break;
+    }
+    case None:
+        break;
+    }
+    return dates;
+}
+
+qint64 Recurrence::firstPeriod(const QDate &start, const QDate &from) const
+{
+    if (from <= start)
+        return 0;
+    switch (m_frequency) {
+    case Daily:
+        return start.daysTo(from) / m_interval;
+    case Weekly:
+        return weekStart(start).daysTo(weekStart(from)) / 7 / m_interval;
+    case Monthly:
+        return monthsBetween(start, from) / m_interval;
+    case Yearly:
+        return (from.year() - start.year()) / m_interval;
+    case None:
+        break;
+    }
+    return 0;
+}
+
+QVector<QDate> Recurrence::occurrences(const QDate &start, const QDate &from, const QDate &to) const
+{
+    QVector<QDate> result;
+    if (!isValid() || !start.isValid() || from > to)
+        return result;
+
+    QDate last = to;
+    if (m_until.isValid() && m_until < last)
+        last = m_until;
+
+    // С COUNT номер повторения зависит от всех предыдущих, поэтому счёт идёт с начала;
+    // без него первый период окна вычисляется сразу
+    int produced = 0;
+    for (qint64 number = m_count > 0 ? 0 : firstPeriod(start, from); periodStart(start, number) <= last; ++number) {
+        for (const QDate &date : periodDates(start, number)) {
+            if (date < start || date > last)
+                continue;
+            if (m_count > 0 && ++produced > m_count)
+                return result;
+            if (date >= from)
+                result.append(date);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,43 @@
+#ifndef RECURRENCE_H
+#define RECURRENCE_H
+
+#include <QString>
+#include <QDate>
+#include <QVector>
+
+// Правило повторения задачи - подмножество RRULE (RFC 5545):
+// FREQ=DAILY|WEEKLY|MONTHLY|YEARLY, INTERVAL, COUNT, UNTIL=YYYYMMDD,
+// BYDAY=MO,TU,... (для WEEKLY), BYMONTHDAY=N или -1 (для MONTHLY).
+// Первое повторение - дата задачи. Повторения не хранятся: они считаются
+// только для запрошенного окна дат, начало окна находится арифметически.
+class Recurrence
+{
+public:
+    enum Frequency { None, Daily, Weekly, Monthly, Yearly };
+
+    static Recurrence parse(const QString &rule);
+
+    bool isValid() const { return m_frequency != None; }
+    QString toString() const;
+    // Описание для списка задач: "каждую неделю (пн, ср)"
+    QString describe() const;
+
+    // Даты повторений в [from, to] по возрастанию; start - первое повторение
+    QVector<QDate> occurrences(const QDate &start, const QDate &from, const QDate &to) const;
+
+private:
+    // Даты периода number (день, неделя, месяц, год от start) по возрастанию
+    QVector<QDate> periodDates(const QDate &start, qint64 number) const;
+    QDate periodStart(const QDate &start, qint64 number) const;
+    // Первый период, который может содержать from
+    qint64 firstPeriod(const QDate &start, const QDate &from) const;
+
+    Frequency m_frequency = None;
+    int m_interval = 1;
+    int m_count = 0;            // 0 - без ограничения
+    QDate m_until;
+    QVector<int> m_byDay;       // дни недели 1..7 (Qt::Monday..Qt::Sunday)
+    int m_byMonthDay = 0;       // 0 - число из даты начала, -1 - последний день месяца
+};
+
+#endif // RECURRENCE_H
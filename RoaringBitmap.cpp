@@ -0,0 +1,291 @@
+#include "RoaringBitmap.h"
+
+#include <algorithm>
+#include <iterator>
+
+bool RoaringBitmap::Container::contains(quint16 low) const
+{
+    if (isBitmap())
+        return (words.at(low >> 6) >> (low & 63)) & 1;
+    return std::binary_search(array.cbegin(), array.cend(), low);
+}
+
+bool RoaringBitmap::Container::add(quint16 low)
+{
+    if (isBitmap()) {
+        quint64 &word = words[low >> 6];
+        const quint64 bit = quint64(1) << (low & 63);
+        if (word & bit)
+            return false;
+        word |= bit;
+        ++cardinality;
+        return true;
+    }
+
+    auto it = std::lower_bound(array.begin(), array.end(), low);
+    if (it != array.end() && *it == low)
+        return false;
+    array.insert(it, low);
+    ++cardinality;
+    if (cardinality > ArrayLimit)
+        toBitmap();
+    return true;
+}
+
+bool RoaringBitmap::Container::remove(quint16 low)
+{
+    if (isBitmap()) {
+        quint64 &word = words[low >> 6];
+        const quint64 bit = quint64(1) << (low & 63);
+        if (!(word & bit))
+            return false;
+        word &= ~bit;
+        --cardinality;
+        shrinkIfSparse();
+        return true;
+    }
+
+    auto it = std::lower_bound(array.begin(), array.end(), low);
+    if (it == array.end() || *it != low)
+        return false;
+    array.erase(it);
+    --cardinality;
+    return true;
+}
+
+void RoaringBitmap::Container::toBitmap()
+{
+    words = bitmapWords();
+    array.clear();
+    array.squeeze();
+}
+
+void RoaringBitmap::Container::shrinkIfSparse()
+{
+    if (!isBitmap() || cardinality > ArrayLimit)
+        return;
+
+    QVector<quint16> values;
+    values.reserve(cardinality);
+    for (int w = 0; w < words.size(); ++w) {
+        quint64 word = words.at(w);
+        while (word) {
+            values.append(quint16(w * 64 + qCountTrailingZeroBits(word)));
+            word &= word - 1;
+        }
+    }
+    array = values;
+    words.clear();
+    words.squeeze();
+}
+
+QVector<quint64> RoaringBitmap::Container::bitmapWords() const
+{
+    if (isBitmap())
+        return words;
+
+    QVector<quint64> result(WordCount, 0);
+    for (quint16 low : array)
+        result[low >> 6] |= quint64(1) << (low & 63);
+    return result;
+}
+
+RoaringBitmap::Container RoaringBitmap::Container::fromWords(QVector<quint64> words)
+{
+    Container c;
+    for (quint64 word : std::as_const(words))
+        c.cardinality += qPopulationCount(word);
+    c.words = std::move(words);
+    c.shrinkIfSparse();
+    return c;
+}
+
+RoaringBitmap::Container RoaringBitmap::Container::intersect(const Container &a, const Container &b)
+{
+    if (a.isBitmap() && b.isBitmap()) {
+        QVector<quint64> words(WordCount);
+        for (int w = 0; w < WordCount; ++w)
+            words[w] = a.words.at(w) & b.words.at(w);
+        return fromWords(std::move(words));
+    }
+
+    // Хотя бы один разреженный - результат не больше него
+    Container c;
+    if (!a.isBitmap() && !b.isBitmap()) {
+        std::set_intersection(a.array.cbegin(), a.array.cend(), b.array.cbegin(), b.array.cend(),
+                              std::back_inserter(c.array));
+    } else {
+        const Container &sparse = a.isBitmap() ? b : a;
+        const Container &dense = a.isBitmap() ? a : b;
+        for (quint16 low : sparse.array) {
+            if (dense.contains(low))
+                c.array.append(low);
+        }
+    }
+    c.cardinality = c.array.size();
+    return c;
+}
+
+RoaringBitmap::Container RoaringBitmap::Container::unite(const Container &a, const Container &b)
+{
+    if (!a.isBitmap() && !b.isBitmap() && a.cardinality + b.cardinality <= ArrayLimit) {
+        Container c;
+        std::set_union(a.array.cbegin(), a.array.cend(), b.array.cbegin(), b.array.cend(),
+                       std::back_inserter(c.array));
+        c.cardinality = c.array.size();
+        return c;
+    }
+
+    QVector<quint64> words = a.bitmapWords();
+    if (b.isBitmap()) {
+        for (int w = 0; w < WordCount; ++w)
+            words[w] |= b.words.at(w);
+    } else {
+        for (quint16 low : b.array)
+            words[low >> 6] |= quint64(1) << (low & 63);
+    }
+    return fromWords(std::move(words));
+}
+
+RoaringBitmap::Container RoaringBitmap::Container::subtract(const Container &a, const Container &b)
+{
+    if (!a.isBitmap()) {
+        Container c;
+        for (quint16 low : a.array) {
+            if (!b.contains(low))
+                c.array.append(low);
+        }
+        c.cardinality = c.array.size();
+        return c;
+    }
+
+    QVector<quint64> words = a.words;
+    if (b.isBitmap()) {
+        for (int w = 0; w < WordCount; ++w)
+            words[w] &= ~b.words.at(w);
+    } else {
+        for (quint16 low : b.array)
+            words[low >> 6] &= ~(quint64(1) << (low & 63));
+    }
+    return fromWords(std::move(words));
+}
+
+int RoaringBitmap::findKey(quint16 key) const
+{
+    auto it = std::lower_bound(m_keys.cbegin(), m_keys.cend(), key);
+    if (it != m_keys.cend() && *it == key)
+        return int(it - m_keys.cbegin());
+    return -1;
+}
+
+bool RoaringBitmap::add(quint32 value)
+{
+    const quint16 key = quint16(value >> 16);
+    auto it = std::lower_bound(m_keys.begin(), m_keys.end(), key);
+    const int pos = int(it - m_keys.begin());
+    if (it == m_keys.end() || *it != key) {
+        m_keys.insert(pos, key);
+        m_containers.insert(pos, Container());
+    }
+    return m_containers[pos].add(quint16(value & 0xFFFF));
+}
+
+bool RoaringBitmap::remove(quint32 value)
+{
+    const int pos = findKey(quint16(value >> 16));
+    if (pos < 0)
+        return false;
+    if (!m_containers[pos].remove(quint16(value & 0xFFFF)))
+        return false;
+    if (m_containers.at(pos).cardinality == 0) {
+        m_keys.remove(pos);
+        m_containers.remove(pos);
+    }
+    return true;
+}
+
+bool RoaringBitmap::contains(quint32 value) const
+{
+    const int pos = findKey(quint16(value >> 16));
+    return pos >= 0 && m_containers.at(pos).contains(quint16(value & 0xFFFF));
+}
+
+quint64 RoaringBitmap::cardinality() const
+{
+    quint64 total = 0;
+    for (const Container &c : m_containers)
+        total += c.cardinality;
+    return total;
+}
+
+void RoaringBitmap::clear()
+{
+    m_keys.clear();
+    m_containers.clear();
+}
+
+RoaringBitmap RoaringBitmap::operator&(const RoaringBitmap &other) const
+{
+    RoaringBitmap result;
+    int i = 0, j = 0;
+    while (i < m_keys.size() && j < other.m_keys.size()) {
+        if (m_keys.at(i) < other.m_keys.at(j)) {
+            ++i;
+        } else if (m_keys.at(i) > other.m_keys.at(j)) {
+            ++j;
+        } else {
+            Container c = Container::intersect(m_containers.at(i), other.m_containers.at(j));
+            if (c.cardinality > 0) {
+                result.m_keys.append(m_keys.at(i));
+                result.m_containers.append(std::move(c));
+            }
+            ++i;
+            ++j;
+        }
+    }
+    return result;
+}
+
+RoaringBitmap RoaringBitmap::operator|(const RoaringBitmap &other) const
+{
+    RoaringBitmap result;
+    int i = 0, j = 0;
+    while (i < m_keys.size() || j < other.m_keys.size()) {
+        if (j >= other.m_keys.size() || (i < m_keys.size() && m_keys.at(i) < other.m_keys.at(j))) {
+            result.m_keys.append(m_keys.at(i));
+            result.m_containers.append(m_containers.at(i));
+            ++i;
+        } else if (i >= m_keys.size() || other.m_keys.at(j) < m_keys.at(i)) {
+            result.m_keys.append(other.m_keys.at(j));
+            result.m_containers.append(other.m_containers.at(j));
+            ++j;
+        } else {
+            result.m_keys.append(m_keys.at(i));
+            result.m_containers.append(Container::unite(m_containers.at(i), other.m_containers.at(j)));
+            ++i;
+            ++j;
+        }
+    }
+    return result;
+}
+
+RoaringBitmap RoaringBitmap::operator-(const RoaringBitmap &other) const
+{
+    RoaringBitmap result;
+    int j = 0;
+    for (int i = 0; i < m_keys.size(); ++i) {
+        while (j < other.m_keys.size() && other.m_keys.at(j) < m_keys.at(i))
+            ++j;
+        if (j < other.m_keys.size() && other.m_keys.at(j) == m_keys.at(i)) {
+            Container c = Container::subtract(m_containers.at(i), other.m_containers.at(j));
+            if (c.cardinality > 0) {
+                result.m_keys.append(m_keys.at(i));
+                result.m_containers.append(std::move(c));
+            }
+        } else {
+            result.m_keys.append(m_keys.at(i));
+            result.m_containers.append(m_containers.at(i));
+        }
+    }
+    return result;
+}
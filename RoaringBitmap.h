@@ -0,0 +1,76 @@
+#ifndef ROARINGBITMAP_H
+#define ROARINGBITMAP_H
+
+#include <QVector>
+#include <QtAlgorithms>
+#include <QtGlobal>
+
+// Сжатое множество 32-битных id в духе Roaring: старшие 16 бит выбирают
+// контейнер, младшие хранятся либо отсортированным массивом (разреженный
+// контейнер), либо битовой картой из 1024 слов (плотный контейнер).
+// Пересечение, объединение и разность плотных контейнеров - пословные операции.
+class RoaringBitmap
+{
+public:
+    bool add(quint32 value);
+    bool remove(quint32 value);
+    bool contains(quint32 value) const;
+    quint64 cardinality() const;
+    bool isEmpty() const { return m_keys.isEmpty(); }
+    void clear();
+
+    RoaringBitmap operator&(const RoaringBitmap &other) const;
+    RoaringBitmap operator|(const RoaringBitmap &other) const;
+    RoaringBitmap operator-(const RoaringBitmap &other) const;   // AND NOT
+
+    template <typename Fn>
+    void forEach(Fn fn) const
+    {
+        for (int i = 0; i < m_keys.size(); ++i) {
+            const quint32 high = quint32(m_keys.at(i)) << 16;
+            const Container &c = m_containers.at(i);
+            if (c.isBitmap()) {
+                for (int w = 0; w < c.words.size(); ++w) {
+                    quint64 word = c.words.at(w);
+                    while (word) {
+                        fn(high | quint32(w * 64 + qCountTrailingZeroBits(word)));
+                        word &= word - 1;
+                    }
+                }
+            } else {
+                for (quint16 low : c.array)
+                    fn(high | low);
+            }
+        }
+    }
+
+private:
+    static constexpr int ArrayLimit = 4096;
+    static constexpr int WordCount = 65536 / 64;
+
+    struct Container {
+        QVector<quint16> array;     // разреженный: отсортированные значения
+        QVector<quint64> words;     // плотный: битовая карта, иначе пусто
+        int cardinality = 0;
+
+        bool isBitmap() const { return !words.isEmpty(); }
+        bool contains(quint16 low) const;
+        bool add(quint16 low);
+        bool remove(quint16 low);
+        void toBitmap();
+        void shrinkIfSparse();
+        QVector<quint64> bitmapWords() const;
+
+        static Container intersect(const Container &a, const Container &b);
+        static Container unite(const Container &a, const Container &b);
+        static Container subtract(const Container &a, const Container &b);
+        static Container fromWords(QVector<quint64> words);
+    };
+
+    int findKey(quint16 key) const;
+
+    QVector<quint16> m_keys;            // старшие 16 бит, по возрастанию
+    QVector<Container> m_containers;    // контейнер для каждого ключа
+};
+
+#endif // ROARINGBITMAP_H
@@ -0,0 +1,17 @@
+#ifndef SEARCHHIT_H
+#define SEARCHHIT_H
+
+#include <QString>
+#include <QtGlobal>
+
+// Результат полнотекстового поиска по задачам и заметкам
+struct SearchHit {
+    enum Kind { TaskHit, NoteHit };
+
+    Kind kind = TaskHit;
+    qint64 id = 0;
+    QString snippet;    // фрагмент с совпадением, совпадения обрамлены [ ]
+    double rank = 0;    // bm25, делённый на лучший в своей таблице: -1 - лучшее, меньше - релевантнее
+};
+
+#endif // SEARCHHIT_H
@@ -0,0 +1,95 @@
+#ifndef SEARCHWIDGET_H
+#define SEARCHWIDGET_H
+
+#include <QWidget>
+#include <QVBoxLayout>
+#include <QLabel>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QTimer>
+#include "AsyncDatabase.h"
+
+// Поиск по мере ввода: запрос уходит в FTS5 на потоке чтения,
+// устаревшие ответы отбрасываются
+class SearchWidget : public QWidget {
+    Q_OBJECT
+public:
+    SearchWidget(AsyncDatabase *db, QWidget *parent = nullptr) : QWidget(parent), db(db) {
+        QVBoxLayout *mainLayout = new QVBoxLayout(this);
+
+        QLabel *title = new QLabel("🔍 Поиск");
+        title->setAlignment(Qt::AlignCenter);
+        title->setProperty("role", "pageTitle");
+        mainLayout->addWidget(title);
+
+        searchInput = new QLineEdit;
+        searchInput->setPlaceholderText("Поиск по задачам и заметкам...");
+        searchInput->setClearButtonEnabled(true);
+        mainLayout->addWidget(searchInput);
+
+        resultList = new QListWidget;
+        resultList->setUniformItemSizes(true);
+        mainLayout->addWidget(resultList);
+
+        // Короткая пауза, чтобы не запускать запрос на каждое нажатие при быстром вводе
+        debounceTimer = new QTimer(this);
+        debounceTimer->setSingleShot(true);
+        debounceTimer->setInterval(80);
+
+        connect(searchInput, &QLineEdit::textChanged, debounceTimer, qOverload<>(&QTimer::start));
+        connect(debounceTimer, &QTimer::timeout, this, &SearchWidget::runSearch);
+        connect(resultList, &QListWidget::itemActivated, this, &SearchWidget::openResult);
+    }
+
+signals:
+    void taskActivated(qint64 id);
+    void noteActivated(qint64 id);
+
+private:
+    AsyncDatabase *db;
+    QLineEdit *searchInput;
+    QListWidget *resultList;
+    QTimer *debounceTimer;
+    int searchSerial = 0;
+
+    void runSearch() {
+        const int serial = ++searchSerial;
+        const QString text = searchInput->text().trimmed();
+        if (text.isEmpty()) {
+            resultList->clear();
+            return;
+        }
+
+        db->read([text](DatabaseManager &m) {
+            return m.search(text, 50);
+        }).then(this, [this, serial](const QVector<SearchHit> &hits) {
+            if (serial == searchSerial)
+                showResults(hits);
+        });
+    }
+
+    void showResults(const QVector<SearchHit> &hits) {
+        resultList->clear();
+        for (const SearchHit &hit : hits) {
+            const QString prefix = hit.kind == SearchHit::TaskHit ? "📋 " : "📝 ";
+            QListWidgetItem *item = new QListWidgetItem(prefix + hit.snippet.simplified());
+            item->setData(Qt::UserRole, int(hit.kind));
+            item->setData(Qt::UserRole + 1, hit.id);
+            resultList->addItem(item);
+        }
+        if (hits.isEmpty())
+            resultList->addItem("Ничего не найдено");
+    }
+
+    void openResult(QListWidgetItem *item) {
+        const QVariant id = item->data(Qt::UserRole + 1);
+        if (!id.isValid())
+            return;
+        if (item->data(Qt::UserRole).toInt() == SearchHit::TaskHit)
+            emit taskActivated(id.toLongLong());
+        else
+            emit noteActivated(id.toLongLong());
+    }
+};
+
+#endif // SEARCHWIDGET_H
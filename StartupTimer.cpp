@@ -0,0 +1,44 @@
+#include "StartupTimer.h"
+
+#include <QFile>
+#include <QDateTime>
+#include <QStringList>
+#include <QDebug>
+
+QElapsedTimer StartupTimer::s_timer;
+QVector<QPair<QString, qint64>> StartupTimer::s_marks;
+bool StartupTimer::s_finished = false;
+
+void StartupTimer::start()
+{
+    s_timer.start();
+    s_marks.clear();
+    s_finished = false;
+}
+
+void StartupTimer::mark(const QString &stage)
+{
+    if (!s_timer.isValid() || s_finished)
+        return;
+    s_marks.append({stage, s_timer.elapsed()});
+}
+
+void StartupTimer::finish(const QString &stage, const QString &logPath)
+{
+    if (!s_timer.isValid() || s_finished)
+        return;
+    mark(stage);
+    s_finished = true;
+
+    QStringList parts;
+    for (const auto &mark : std::as_const(s_marks))
+        parts.append(QString("%1 %2 ms").arg(mark.first).arg(mark.second));
+    const QString line = QDateTime::currentDateTime().toString(Qt::ISODate) + "  " + parts.join(" | ");
+
+    QFile file(logPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        qWarning() << "Failed to write startup log:" << file.errorString();
+        return;
+    }
+    file.write(line.toUtf8() + '\n');
+}
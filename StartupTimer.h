@@ -0,0 +1,27 @@
+#ifndef STARTUPTIMER_H
+#define STARTUPTIMER_H
+
+#include <QString>
+#include <QVector>
+#include <QPair>
+#include <QElapsedTimer>
+
+// Замеры времени запуска: этапы отмечаются по мере прохождения,
+// отчёт дописывается строкой в лог. Отсчёт идёт от входа в main().
+class StartupTimer
+{
+public:
+    static void start();
+    static void mark(const QString &stage);
+    static bool isFinished() { return s_finished; }
+
+    // Отмечает последний этап и дописывает отчёт; повторные вызовы ничего не делают
+    static void finish(const QString &stage, const QString &logPath = "startup.log");
+
+private:
+    static QElapsedTimer s_timer;
+    static QVector<QPair<QString, qint64>> s_marks;
+    static bool s_finished;
+};
+
+#endif // STARTUPTIMER_H
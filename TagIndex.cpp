@@ -0,0 +1,309 @@
+#include "TagIndex.h"
+#include "TaskSnapshot.h"
+#include "Trace.h"
+
+namespace {
+
+// Разбор выражения рекурсивным спуском:
+//   or  := and ('|' and)*
+//   and := not ('&' not)*
+//   not := '!' not | '(' or ')' | тег
+// Тег с операторами или пробелами по краям пишется в кавычках: "R&D",
+// кавычка внутри имени удваивается
+class TagExpressionParser
+{
+public:
+    TagExpressionParser(const TagIndex &index, const QString &expression)
+        : m_index(index)
+    {
+        QString name;
+        auto flushName = [&]() {
+            if (!name.trimmed().isEmpty())
+                m_tokens.append(Token{name.trimmed(), false});
+            name.clear();
+        };
+        for (int i = 0; i < expression.size(); ++i) {
+            const QChar ch = expression.at(i);
+            if (ch == '"') {
+                flushName();
+                QString quoted;
+                bool closed = false;
+                while (++i < expression.size()) {
+                    if (expression.at(i) == '"') {
+                        if (i + 1 < expression.size() && expression.at(i + 1) == '"') {
+                            quoted.append('"');
+                            ++i;
+                            continue;
+                        }
+                        closed = true;
+                        break;
+                    }
+                    quoted.append(expression.at(i));
+                }
+                if (!closed)
+                    m_ok = false;
+                m_tokens.append(Token{quoted, false});
+            } else if (ch == '&' || ch == '|' || ch == '!' || ch == '(' || ch == ')') {
+                flushName();
+                m_tokens.append(Token{QString(ch), true});
+            } else {
+                name.append(ch);
+            }
+        }
+        flushName();
+    }
+
+    RoaringBitmap parse(bool *ok)
+    {
+        RoaringBitmap result = parseOr();
+        if (m_pos != m_tokens.size())
+            m_ok = false;
+        if (ok)
+            *ok = m_ok;
+        return m_ok ? result : RoaringBitmap();
+    }
+
+private:
+    struct Token {
+        QString text;
+        bool isOperator;
+    };
+
+    bool accept(const QString &token)
+    {
+        if (m_pos < m_tokens.size() && m_tokens.at(m_pos).isOperator && m_tokens.at(m_pos).text == token) {
+            ++m_pos;
+            return true;
+        }
+        return false;
+    }
+
+    RoaringBitmap parseOr()
+    {
+        RoaringBitmap result = parseAnd();
+        while (accept("|"))
+            result = result | parseAnd();
+        return result;
+    }
+
+    RoaringBitmap parseAnd()
+    {
+        RoaringBitmap result = parseNot();
+        while (accept("&"))
+            result = result & parseNot();
+        return result;
+    }
+
+    RoaringBitmap parseNot()
+    {
+        if (accept("!"))
+            return m_index.allTasks() - parseNot();
+        if (accept("(")) {
+            RoaringBitmap result = parseOr();
+            if (!accept(")"))
+                m_ok = false;
+            return result;
+        }
+        if (m_pos >= m_tokens.size() || m_tokens.at(m_pos).isOperator) {
+            m_ok = false;
+            return RoaringBitmap();
+        }
+        return m_index.tasksWithTag(m_tokens.at(m_pos++).text);
+    }
+
+    const TagIndex &m_index;
+    QVector<Token> m_tokens;
+    int m_pos = 0;
+    bool m_ok = true;
+};
+
+} // namespace
+
+TagIndex::TagIndex(QObject *parent)
+    : QObject(parent)
+{
+}
+
+int TagIndex::internTag(const QString &tag)
+{
+    auto it = m_tagIds.constFind(tag);
+    if (it != m_tagIds.constEnd())
+        return it.value();
+
+    const int tagId = m_tagNames.size();
+    m_tagIds.insert(tag, tagId);
+    m_tagNames.append(tag);
+    m_refCounts.append(0);
+    m_bitmaps.append(RoaringBitmap());
+    return tagId;
+}
+
+void TagIndex::releaseTag(int tagId)
+{
+    // Номер тега сохраняется: тег может вернуться, а номера не переиспользуются
+    if (--m_refCounts[tagId] == 0)
+        emit tagRemoved(m_tagNames.at(tagId));
+}
+
+int TagIndex::tagOf(qint64 id) const
+{
+    return m_taskTags.value(quint32(id), -1);
+}
+
+void TagIndex::addTask(qint64 id, const QString &tag)
+{
+    if (m_all.contains(quint32(id))) {
+        setTaskTag(id, tag);
+        return;
+    }
+
+    ++m_version;
+    m_all.add(quint32(id));
+    if (tag.isEmpty())
+        return;
+
+    const int tagId = internTag(tag);
+    m_bitmaps[tagId].add(quint32(id));
+    m_taskTags.insert(quint32(id), tagId);
+    if (++m_refCounts[tagId] == 1)
+        emit tagAdded(tag);
+}
+
+void TagIndex::removeTask(qint64 id)
+{
+    if (!m_all.contains(quint32(id)))
+        return;
+
+    ++m_version;
+    const int tagId = tagOf(id);
+    m_all.remove(quint32(id));
+    if (tagId >= 0) {
+        m_bitmaps[tagId].remove(quint32(id));
+        m_taskTags.remove(quint32(id));
+        releaseTag(tagId);
+    }
+}
+
+void TagIndex::setTaskTag(qint64 id, const QString &tag)
+{
+    if (!m_all.contains(quint32(id))) {
+        addTask(id, tag);
+        return;
+    }
+
+    const int oldTagId = tagOf(id);
+    const int newTagId = tag.isEmpty() ? -1 : internTag(tag);
+    if (oldTagId == newTagId)
+        return;
+
+    ++m_version;
+    if (newTagId >= 0) {
+        m_bitmaps[newTagId].add(quint32(id));
+        m_taskTags.insert(quint32(id), newTagId);
+        if (++m_refCounts[newTagId] == 1)
+            emit tagAdded(tag);
+    } else {
+        m_taskTags.remove(quint32(id));
+    }
+    if (oldTagId >= 0) {
+        m_bitmaps[oldTagId].remove(quint32(id));
+        releaseTag(oldTagId);
+    }
+}
+
+void TagIndex::clear()
+{
+    ++m_version;
+    for (int tagId = 0; tagId < m_tagNames.size(); ++tagId) {
+        if (m_refCounts.at(tagId) > 0)
+            emit tagRemoved(m_tagNames.at(tagId));
+    }
+    m_tagIds.clear();
+    m_tagNames.clear();
+    m_refCounts.clear();
+    m_bitmaps.clear();
+    m_taskTags.clear();
+    m_all.clear();
+}
+
+TagIndex::Batch TagIndex::batchFromSnapshot(const TaskSnapshot &snapshot)
+{
+    TRACE_SCOPE_DETAIL("tags", "batchFromSnapshot", QString::number(snapshot.count()));
+    Batch batch;
+    batch.bitmaps.resize(snapshot.tagCount());
+    for (int i = 0; i < snapshot.count(); ++i) {
+        const quint32 id = quint32(snapshot.id(i));
+        batch.all.add(id);
+        const int tag = snapshot.tagNumber(i);
+        if (tag >= 0) {
+            batch.bitmaps[tag].add(id);
+            batch.taskTags.insert(id, tag);
+        }
+    }
+    for (int tag = 0; tag < snapshot.tagCount(); ++tag)
+        batch.tags.append(snapshot.tagName(tag));
+    return batch;
+}
+
+void TagIndex::addBatch(const Batch &batch)
+{
+    TRACE_SCOPE("tags", "addBatch");
+    ++m_version;
+    m_all = m_all | batch.all;
+
+    // В пустом индексе номера тегов пакета совпадают с выдаваемыми по порядку,
+    // и карта пакета берётся целиком; иначе номера переводятся
+    QVector<int> tagIds;
+    bool sameNumbers = true;
+    for (int i = 0; i < batch.tags.size(); ++i) {
+        tagIds.append(internTag(batch.tags.at(i)));
+        sameNumbers = sameNumbers && tagIds.last() == i;
+    }
+    if (sameNumbers && m_taskTags.isEmpty()) {
+        m_taskTags = batch.taskTags;
+    } else {
+        for (auto it = batch.taskTags.constBegin(); it != batch.taskTags.constEnd(); ++it)
+            m_taskTags.insert(it.key(), tagIds.at(it.value()));
+    }
+
+    for (int i = 0; i < batch.tags.size(); ++i) {
+        const RoaringBitmap &ids = batch.bitmaps.at(i);
+        if (ids.isEmpty())
+            continue;
+        const int tagId = tagIds.at(i);
+        const bool wasEmpty = m_refCounts.at(tagId) == 0;
+        m_bitmaps[tagId] = m_bitmaps.at(tagId) | ids;
+        m_refCounts[tagId] = int(m_bitmaps.at(tagId).cardinality());
+        if (wasEmpty)
+            emit tagAdded(batch.tags.at(i));
+    }
+}
+
+QStringList TagIndex::tags() const
+{
+    QStringList result;
+    for (int tagId = 0; tagId < m_tagNames.size(); ++tagId) {
+        if (m_refCounts.at(tagId) > 0)
+            result.append(m_tagNames.at(tagId));
+    }
+    return result;
+}
+
+int TagIndex::taskCount(const QString &tag) const
+{
+    const int tagId = m_tagIds.value(tag, -1);
+    return tagId >= 0 ? m_refCounts.at(tagId) : 0;
+}
+
+RoaringBitmap TagIndex::tasksWithTag(const QString &tag) const
+{
+    const int tagId = m_tagIds.value(tag, -1);
+    return tagId >= 0 ? m_bitmaps.at(tagId) : RoaringBitmap();
+}
+
+RoaringBitmap TagIndex::evaluate(const QString &expression, bool *ok) const
+{
+    TRACE_SCOPE_DETAIL("filter", "TagIndex::evaluate", expression);
+    TagExpressionParser parser(*this, expression);
+    return parser.parse(ok);
+}
@@ -0,0 +1,72 @@
+#ifndef TAGINDEX_H
+#define TAGINDEX_H
+
+#include <QObject>
+#include <QHash>
+#include <QVector>
+#include <QStringList>
+#include "RoaringBitmap.h"
+
+class TaskSnapshot;
+
+// Индекс тегов: каждому тегу выдаётся постоянный номер, для него хранится
+// счётчик задач и битовое множество их id. Компактная карта id -> номер тега
+// (только задачи с тегом) делает изменение задачи O(1), фильтр по
+// выражению из тегов - несколько операций над множествами.
+class TagIndex : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TagIndex(QObject *parent = nullptr);
+
+    void addTask(qint64 id, const QString &tag);
+    void removeTask(qint64 id);
+    void setTaskTag(qint64 id, const QString &tag);
+    void clear();
+
+    // Множества тегов для множества задач, собранные вне индекса (например,
+    // в потоке чтения) и добавляемые в него объединением множеств.
+    // Задачи пакета не должны уже быть в индексе
+    struct Batch {
+        QVector<QString> tags;
+        QVector<RoaringBitmap> bitmaps;     // по одному на тег
+        QHash<quint32, int> taskTags;       // id -> номер тега в tags
+        RoaringBitmap all;
+    };
+    // Пакет из столбца тегов снимка, без чтения задач целиком
+    static Batch batchFromSnapshot(const TaskSnapshot &snapshot);
+    void addBatch(const Batch &batch);
+
+    QStringList tags() const;
+    int taskCount(const QString &tag) const;
+    RoaringBitmap tasksWithTag(const QString &tag) const;
+    const RoaringBitmap &allTasks() const { return m_all; }
+
+    // Выражение из тегов: & - и, | - или, ! - не, скобки для группировки,
+    // например "работа & !срочно | (дом & выходные)". Имя тега с
+    // операторами берётся в кавычки: "R&D" & !срочно
+    RoaringBitmap evaluate(const QString &expression, bool *ok = nullptr) const;
+
+    // Растёт при каждом изменении, по нему фильтры понимают, что пора пересчитаться
+    quint64 version() const { return m_version; }
+
+signals:
+    // Первая задача с тегом появилась / последняя исчезла
+    void tagAdded(const QString &tag);
+    void tagRemoved(const QString &tag);
+
+private:
+    int internTag(const QString &tag);
+    void releaseTag(int tagId);
+    int tagOf(qint64 id) const;
+
+    QHash<QString, int> m_tagIds;
+    QVector<QString> m_tagNames;
+    QVector<int> m_refCounts;
+    QVector<RoaringBitmap> m_bitmaps;
+    QHash<quint32, int> m_taskTags;     // id -> номер тега, только задачи с тегом
+    RoaringBitmap m_all;
+    quint64 m_version = 0;
+};
+
+#endif // TAGINDEX_H
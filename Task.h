@@ -0,0 +1,29 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include <QString>
+#include <QDate>
+#include <QtGlobal>
+#include "Recurrence.h"
+
+// Данные одной задачи без привязки к виджетам
+struct Task {
+    qint64 id = 0;      // стабильный идентификатор, по нему ведётся журнал изменений
+    QString text;
+    QDate date;         // срок, невалидная дата - без срока
+    QString tag;
+    bool completed = false;
+    QString recurrence; // правило RRULE, пустое - задача не повторяется; date - первое повторение
+
+    bool isRecurring() const { return !recurrence.isEmpty(); }
+
+    QString displayText() const {
+        QString fullText = text;
+        if (date.isValid()) fullText += "  ⏰ " + date.toString("dd.MM.yyyy");
+        if (isRecurring()) fullText += "  🔁 " + Recurrence::parse(recurrence).describe();
+        if (!tag.isEmpty()) fullText += "  🏷 " + tag;
+        return fullText;
+    }
+};
+
+#endif // TASK_H
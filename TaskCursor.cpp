@@ -0,0 +1,79 @@
+#include "TaskCursor.h"
+#include "DatabaseManager.h"
+#include "Trace.h"
+
+TaskCursor::TaskCursor(const QSqlDatabase &db, int batchSize, const Position &position)
+    : m_undatedQuery(db),
+      m_datedQuery(db),
+      m_batchSize(batchSize),
+      m_undatedDone(position.undatedDone),
+      m_atEnd(position.atEnd),
+      m_lastDate(position.lastDate),
+      m_lastId(position.lastId)
+{
+    m_undatedQuery.setForwardOnly(true);
+    m_datedQuery.setForwardOnly(true);
+
+    // Задачи без срока (NULL) идут первыми, как и в ORDER BY date, id
+    if (!m_undatedQuery.prepare("SELECT id, text, date, tag, completed, rrule FROM Tasks "
+                                "WHERE date IS NULL AND id > :id ORDER BY id LIMIT :limit"))
+        qWarning() << "Failed to prepare task cursor:" << m_undatedQuery.lastError().text();
+
+    // Сравнение кортежей SQLite превращает в диапазон по индексу Tasks(date)
+    if (!m_datedQuery.prepare("SELECT id, text, date, tag, completed, rrule FROM Tasks "
+                              "WHERE (date, id) > (:date, :id) ORDER BY date, id LIMIT :limit"))
+        qWarning() << "Failed to prepare task cursor:" << m_datedQuery.lastError().text();
+}
+
+QVector<Task> TaskCursor::fetchNext()
+{
+    TRACE_SCOPE("sql", "TaskCursor::fetchNext");
+    QVector<Task> batch;
+    if (m_atEnd)
+        return batch;
+    batch.reserve(m_batchSize);
+
+    if (!m_undatedDone) {
+        m_undatedQuery.bindValue(":id", m_lastId);
+        m_undatedQuery.bindValue(":limit", m_batchSize);
+        if (readBatch(m_undatedQuery, batch) < 0) {
+            m_atEnd = true;
+            return batch;
+        }
+        if (batch.size() == m_batchSize) {
+            m_lastId = batch.last().id;
+            return batch;
+        }
+        // Без срока больше нет - остаток порции добирается задачами со сроком
+        m_undatedDone = true;
+        m_lastId = 0;
+    }
+
+    m_datedQuery.bindValue(":date", m_lastDate);
+    m_datedQuery.bindValue(":id", m_lastId);
+    m_datedQuery.bindValue(":limit", m_batchSize - batch.size());
+    const int read = readBatch(m_datedQuery, batch);
+    if (read <= 0 || batch.size() < m_batchSize)
+        m_atEnd = true;
+    if (read > 0) {
+        m_lastDate = batch.last().date.toJulianDay();
+        m_lastId = batch.last().id;
+    }
+    return batch;
+}
+
+int TaskCursor::readBatch(QSqlQuery &query, QVector<Task> &batch)
+{
+    if (!query.exec()) {
+        qWarning() << "Failed to fetch tasks:" << query.lastError().text();
+        return -1;
+    }
+    int read = 0;
+    while (query.next()) {
+        batch.append(DatabaseManager::taskFromQuery(query));
+        ++read;
+    }
+    // Отпускаем блокировку чтения до следующей порции
+    query.finish();
+    return read;
+}
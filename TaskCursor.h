@@ -0,0 +1,44 @@
+#ifndef TASKCURSOR_H
+#define TASKCURSOR_H
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QVector>
+#include <limits>
+#include "Task.h"
+
+// Потоковое чтение задач порциями в порядке (date, id).
+// Каждая порция - отдельный запрос с ключом после последней прочитанной
+// строки (keyset), поэтому между порциями база не держит открытый курсор,
+// а память ограничена размером порции.
+class TaskCursor
+{
+public:
+    // Место чтения: по нему курсор продолжается на другом соединении
+    struct Position {
+        bool undatedDone = false;
+        bool atEnd = false;
+        qint64 lastDate = std::numeric_limits<qint64>::min();
+        qint64 lastId = 0;
+    };
+
+    explicit TaskCursor(const QSqlDatabase &db, int batchSize = 500, const Position &position = Position());
+
+    // Следующая порция; пустой результат - задачи закончились
+    QVector<Task> fetchNext();
+    bool atEnd() const { return m_atEnd; }
+    Position position() const { return {m_undatedDone, m_atEnd, m_lastDate, m_lastId}; }
+
+private:
+    int readBatch(QSqlQuery &query, QVector<Task> &batch);
+
+    QSqlQuery m_undatedQuery;
+    QSqlQuery m_datedQuery;
+    int m_batchSize;
+    bool m_undatedDone;
+    bool m_atEnd;
+    qint64 m_lastDate;
+    qint64 m_lastId;
+};
+
+#endif // TASKCURSOR_H
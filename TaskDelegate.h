@@ -0,0 +1,204 @@
+#ifndef TASKDELEGATE_H
+#define TASKDELEGATE_H
+
+#include <QStyledItemDelegate>
+#include <QApplication>
+#include <QPainter>
+#include <QMouseEvent>
+#include <QKeyEvent>
+#include <QHBoxLayout>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QMessageBox>
+#include "TaskModel.h"
+#include "Theme.h"
+
+// Редактор строки задачи: создаётся только для редактируемой строки
+class TaskEditor : public QWidget {
+    Q_OBJECT
+public:
+    explicit TaskEditor(QWidget *parent = nullptr) : QWidget(parent) {
+        QHBoxLayout *layout = new QHBoxLayout(this);
+        layout->setContentsMargins(0, 0, 0, 0);
+        layout->setSpacing(6);
+
+        lineEdit = new QLineEdit;
+        lineEdit->setProperty("role", "inlineEditor");
+        layout->addWidget(lineEdit);
+
+        QPushButton *saveBtn = new QPushButton("💾");
+        saveBtn->setFixedSize(30, 30);
+        layout->addWidget(saveBtn);
+
+        setFocusProxy(lineEdit);
+        connect(saveBtn, &QPushButton::clicked, this, &TaskEditor::saveRequested);
+    }
+
+    QString text() const { return lineEdit->text(); }
+    void setText(const QString &text) { lineEdit->setText(text); }
+
+signals:
+    void saveRequested();
+
+private:
+    QLineEdit *lineEdit;
+};
+
+// Рисует строки задач (флажок, текст, кнопки ✏️ и ❌) без создания виджетов
+class TaskDelegate : public QStyledItemDelegate {
+    Q_OBJECT
+public:
+    explicit TaskDelegate(QObject *parent = nullptr) : QStyledItemDelegate(parent) {}
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override {
+        const RowGeometry g = geometry(option.rect);
+        const bool completed = index.data(TaskModel::CompletedRole).toBool();
+        const Theme *theme = Theme::instance();
+
+        painter->save();
+        painter->setRenderHint(QPainter::Antialiasing);
+
+        painter->setPen(Qt::NoPen);
+        painter->setBrush(theme->color((option.state & QStyle::State_Selected) ? Theme::CardSelected : Theme::Card));
+        painter->drawRoundedRect(g.frame, 10, 10);
+
+        QStyleOptionButton check;
+        check.rect = g.check;
+        check.state = QStyle::State_Enabled | (completed ? QStyle::State_On : QStyle::State_Off);
+        QStyle *style = option.widget ? option.widget->style() : QApplication::style();
+        style->drawPrimitive(QStyle::PE_IndicatorCheckBox, &check, painter, option.widget);
+
+        QFont font = option.font;
+        font.setPixelSize(16);
+        font.setStrikeOut(completed);
+        painter->setFont(font);
+        painter->setPen(theme->color(completed ? Theme::MutedText : Theme::Text));
+        const QString text = painter->fontMetrics().elidedText(
+            index.data(Qt::DisplayRole).toString(), Qt::ElideRight, g.text.width());
+        painter->drawText(g.text, Qt::AlignVCenter | Qt::AlignLeft, text);
+
+        drawButton(painter, g.edit, "✏️");
+        drawButton(painter, g.remove, "❌");
+
+        painter->restore();
+    }
+
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override {
+        return QSize(QStyledItemDelegate::sizeHint(option, index).width(), RowHeight);
+    }
+
+    QWidget *createEditor(QWidget *parent, const QStyleOptionViewItem &, const QModelIndex &) const override {
+        TaskEditor *editor = new TaskEditor(parent);
+        connect(editor, &TaskEditor::saveRequested, this, &TaskDelegate::commitAndCloseEditor);
+        return editor;
+    }
+
+    void setEditorData(QWidget *editor, const QModelIndex &index) const override {
+        static_cast<TaskEditor *>(editor)->setText(index.data(TaskModel::TextRole).toString());
+    }
+
+    void setModelData(QWidget *editor, QAbstractItemModel *model, const QModelIndex &index) const override {
+        QString text = static_cast<TaskEditor *>(editor)->text().trimmed();
+        if (!text.isEmpty())
+            model->setData(index, text, TaskModel::TextRole);
+    }
+
+    void updateEditorGeometry(QWidget *editor, const QStyleOptionViewItem &option, const QModelIndex &) const override {
+        const RowGeometry g = geometry(option.rect);
+        editor->setGeometry(QRect(QPoint(g.text.left(), g.edit.top()),
+                                  QPoint(g.edit.right(), g.edit.bottom())));
+    }
+
+    bool editorEvent(QEvent *event, QAbstractItemModel *model,
+                     const QStyleOptionViewItem &option, const QModelIndex &index) override {
+        const bool completed = index.data(TaskModel::CompletedRole).toBool();
+
+        if (event->type() == QEvent::KeyPress) {
+            QKeyEvent *key = static_cast<QKeyEvent *>(event);
+            if (key->key() == Qt::Key_Space || key->key() == Qt::Key_Select)
+                return model->setData(index, !completed, TaskModel::CompletedRole);
+            return false;
+        }
+
+        if (event->type() != QEvent::MouseButtonRelease)
+            return false;
+
+        QMouseEvent *mouse = static_cast<QMouseEvent *>(event);
+        if (mouse->button() != Qt::LeftButton)
+            return false;
+
+        const RowGeometry g = geometry(option.rect);
+        const QPoint pos = mouse->position().toPoint();
+        if (g.check.adjusted(-6, -6, 6, 6).contains(pos)) {
+            model->setData(index, !completed, TaskModel::CompletedRole);
+            return true;
+        }
+        if (g.edit.contains(pos)) {
+            emit editRequested(index);
+            return true;
+        }
+        if (g.remove.contains(pos)) {
+            emit removeRequested(index);
+            return true;
+        }
+        return false;
+    }
+
+signals:
+    void editRequested(const QModelIndex &index);
+    void removeRequested(const QModelIndex &index);
+
+private slots:
+    void commitAndCloseEditor() {
+        TaskEditor *editor = qobject_cast<TaskEditor *>(sender());
+        if (!editor)
+            return;
+        if (editor->text().trimmed().isEmpty()) {
+            QMessageBox::warning(editor, "Ошибка", "Задача не может быть пустой!");
+            return;
+        }
+        emit commitData(editor);
+        emit closeEditor(editor);
+    }
+
+private:
+    static constexpr int RowHeight = 56;
+    static constexpr int ButtonSize = 30;
+
+    struct RowGeometry {
+        QRect frame;
+        QRect check;
+        QRect text;
+        QRect edit;
+        QRect remove;
+    };
+
+    static RowGeometry geometry(const QRect &rect) {
+        RowGeometry g;
+        g.frame = rect.adjusted(2, 3, -2, -3);
+        const QRect inner = g.frame.adjusted(10, 0, -10, 0);
+        const int centerY = inner.center().y();
+
+        g.check = QRect(inner.left(), centerY - 9, 18, 18);
+        g.remove = QRect(inner.right() - ButtonSize + 1, centerY - ButtonSize / 2, ButtonSize, ButtonSize);
+        g.edit = g.remove.translated(-(ButtonSize + 6), 0);
+        g.text = QRect(QPoint(g.check.right() + 10, g.frame.top()),
+                       QPoint(g.edit.left() - 10, g.frame.bottom()));
+        return g;
+    }
+
+    static void drawButton(QPainter *painter, const QRect &rect, const QString &label) {
+        painter->setPen(Qt::NoPen);
+        painter->setBrush(Theme::instance()->color(Theme::Accent));
+        painter->drawRoundedRect(rect, 8, 8);
+
+        QFont font = painter->font();
+        font.setPixelSize(14);
+        font.setStrikeOut(false);
+        painter->setFont(font);
+        painter->setPen(Qt::white);
+        painter->drawText(rect, Qt::AlignCenter, label);
+    }
+};
+
+#endif // TASKDELEGATE_H
@@ -0,0 +1,77 @@
+#ifndef TASKFILTERPROXYMODEL_H
+#define TASKFILTERPROXYMODEL_H
+
+#include <QSortFilterProxyModel>
+#include "TaskModel.h"
+#include "TagIndex.h"
+#include "Trace.h"
+
+// Фильтр списка задач по тегу или выражению из тегов. Множество подходящих id
+// считается по индексу тегов один раз на изменение, строка проверяется
+// поиском её id в этом множестве.
+class TaskFilterProxyModel : public QSortFilterProxyModel {
+    Q_OBJECT
+public:
+    TaskFilterProxyModel(TagIndex *index, QObject *parent = nullptr)
+        : QSortFilterProxyModel(parent), m_index(index) {}
+
+    // Пустое выражение снимает фильтр; при ошибке разбора фильтр не меняется
+    bool setTagExpression(const QString &expression) {
+        TRACE_SCOPE_DETAIL("filter", "setTagExpression", expression);
+        const QString trimmed = expression.trimmed();
+        if (!trimmed.isEmpty()) {
+            bool ok = false;
+            RoaringBitmap matches = m_index->evaluate(trimmed, &ok);
+            if (!ok)
+                return false;
+            m_matches = matches;
+            m_matchesVersion = m_index->version();
+        }
+        m_expression = trimmed;
+        m_literal = false;
+        invalidateFilter();
+        return true;
+    }
+
+    // Один тег как есть, без разбора: имя может содержать & | ! ( ) и пробелы
+    void setTag(const QString &tag) {
+        TRACE_SCOPE_DETAIL("filter", "setTag", tag);
+        m_matches = m_index->tasksWithTag(tag);
+        m_matchesVersion = m_index->version();
+        m_expression = tag;
+        m_literal = true;
+        invalidateFilter();
+    }
+
+    QString tagExpression() const { return m_expression; }
+
+    // Тег у уже показанной задачи сменился: строку надо перепроверить
+    void refreshFilter() {
+        if (m_expression.isEmpty() && !m_literal)
+            return;
+        TRACE_SCOPE("filter", "refreshFilter");
+        invalidateFilter();
+    }
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override {
+        if (m_expression.isEmpty() && !m_literal)
+            return true;
+
+        if (m_matchesVersion != m_index->version()) {
+            m_matches = m_literal ? m_index->tasksWithTag(m_expression) : m_index->evaluate(m_expression);
+            m_matchesVersion = m_index->version();
+        }
+        const QModelIndex index = sourceModel()->index(sourceRow, 0, sourceParent);
+        return m_matches.contains(quint32(index.data(TaskModel::IdRole).toLongLong()));
+    }
+
+private:
+    TagIndex *m_index;
+    QString m_expression;
+    bool m_literal = false;     // m_expression - имя тега, а не выражение
+    mutable RoaringBitmap m_matches;
+    mutable quint64 m_matchesVersion = 0;
+};
+
+#endif // TASKFILTERPROXYMODEL_H
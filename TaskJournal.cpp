@@ -0,0 +1,280 @@
+#include "TaskJournal.h"
+#include "Trace.h"
+
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QtConcurrent>
+#include <QDebug>
+
+TaskJournal::TaskJournal(const QString &snapshotPath)
+    : m_snapshotPath(snapshotPath),
+      m_logPath(snapshotPath + ".log"),
+      m_oldLogPath(snapshotPath + ".log.old")
+{
+}
+
+TaskJournal::~TaskJournal()
+{
+    waitForCompaction();
+    if (m_log.isOpen())
+        m_log.close();
+}
+
+QVector<Task> TaskJournal::load()
+{
+    TRACE_SCOPE("journal", "load");
+    waitForCompaction();
+
+    QVector<Task> tasks;
+    QHash<qint64, int> index;
+
+    QFile file(m_snapshotPath);
+    if (file.open(QIODevice::ReadOnly)) {
+        QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+        file.close();
+
+        if (doc.isArray()) {
+            const QJsonArray jsonTasks = doc.array();
+            tasks.reserve(jsonTasks.size());
+            qint64 position = 0;
+            for (const QJsonValue &val : jsonTasks) {
+                ++position;
+                if (!val.isObject()) continue;
+                Task task = taskFromJson(val.toObject());
+                // Старый формат без id: номер позиции в снимке стабилен,
+                // пока снимок не перезаписан
+                if (task.id <= 0) task.id = position;
+                index.insert(task.id, tasks.size());
+                tasks.append(task);
+            }
+        }
+    }
+
+    // Лог, оставшийся от прерванной компакции, идёт раньше текущего
+    replayLog(m_oldLogPath, tasks, index);
+    replayLog(m_logPath, tasks, index);
+
+    QVector<Task> result;
+    result.reserve(index.size());
+    m_nextId = 1;
+    for (const Task &task : std::as_const(tasks)) {
+        if (task.id > 0) {
+            result.append(task);
+            m_nextId = qMax(m_nextId, task.id + 1);
+        }
+    }
+    return result;
+}
+
+void TaskJournal::replayLog(const QString &path, QVector<Task> &tasks, QHash<qint64, int> &index)
+{
+    TRACE_SCOPE_DETAIL("journal", "replayLog", path);
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine().trimmed();
+        if (line.isEmpty()) continue;
+
+        QJsonDocument doc = QJsonDocument::fromJson(line);
+        // Недописанная последняя строка после сбоя пропускается
+        if (!doc.isObject()) continue;
+
+        const QJsonObject record = doc.object();
+        const QString op = record["op"].toString();
+        const qint64 id = record["id"].toInteger();
+        if (id <= 0) continue;
+
+        auto it = index.constFind(id);
+        if (op == "add" || op == "update") {
+            Task task = taskFromJson(record);
+            if (it != index.constEnd()) {
+                tasks[it.value()] = task;
+            } else {
+                index.insert(id, tasks.size());
+                tasks.append(task);
+            }
+        } else if (op == "toggle") {
+            if (it != index.constEnd())
+                tasks[it.value()].completed = record["completed"].toBool();
+        } else if (op == "remove") {
+            if (it != index.constEnd()) {
+                // Помечаем удалённой, чтобы не сдвигать индексы остальных задач
+                tasks[it.value()].id = 0;
+                index.remove(id);
+            }
+        }
+    }
+}
+
+bool TaskJournal::appendAdd(const Task &task)
+{
+    QJsonObject record = taskToJson(task);
+    record["op"] = "add";
+    return appendRecord(record);
+}
+
+bool TaskJournal::appendUpdate(const Task &task)
+{
+    QJsonObject record = taskToJson(task);
+    record["op"] = "update";
+    return appendRecord(record);
+}
+
+bool TaskJournal::appendToggle(qint64 id, bool completed)
+{
+    QJsonObject record;
+    record["op"] = "toggle";
+    record["id"] = id;
+    record["completed"] = completed;
+    return appendRecord(record);
+}
+
+bool TaskJournal::appendRemove(qint64 id)
+{
+    QJsonObject record;
+    record["op"] = "remove";
+    record["id"] = id;
+    return appendRecord(record);
+}
+
+bool TaskJournal::appendRecord(const QJsonObject &record)
+{
+    if (!m_log.isOpen() && !openLog())
+        return false;
+
+    QByteArray line = QJsonDocument(record).toJson(QJsonDocument::Compact);
+    line.append('\n');
+    if (m_log.write(line) != line.size() || !m_log.flush()) {
+        qWarning() << "Failed to append to task journal:" << m_log.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool TaskJournal::openLog()
+{
+    if (m_log.isOpen())
+        m_log.close();
+
+    m_log.setFileName(m_logPath);
+    if (!m_log.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Failed to open task journal:" << m_log.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool TaskJournal::appendLogTo(const QString &path)
+{
+    QFile log(m_logPath);
+    QFile target(path);
+    if (!log.open(QIODevice::ReadOnly) || !target.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Failed to rotate task journal:" << log.errorString() << target.errorString();
+        return false;
+    }
+    // Перевод строки отделяет возможную недописанную строку в конце .old
+    const QByteArray records = '\n' + log.readAll();
+    if (target.write(records) != records.size() || !target.flush()) {
+        qWarning() << "Failed to rotate task journal:" << target.errorString();
+        return false;
+    }
+    target.close();
+    log.close();
+
+    // Лог очищается только после того, как его записи легли в .old
+    if (!log.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Failed to truncate task journal:" << log.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool TaskJournal::needsCompaction() const
+{
+    if (m_compaction.isRunning())
+        return false;
+    return m_log.isOpen() && m_log.size() >= m_compactionThreshold;
+}
+
+void TaskJournal::compact(const QVector<Task> &tasks)
+{
+    if (m_compaction.isRunning())
+        return;
+
+    // Текущий лог уходит в .old и удаляется только после записи снимка:
+    // при сбое он будет повторно применён поверх старого снимка.
+    // Оставшийся .old (прошлая компакция не записала снимок) - единственная
+    // копия своих записей, поэтому текущий лог дописывается в его конец
+    m_log.close();
+    if (!QFile::exists(m_oldLogPath)) {
+        if (!QFile::rename(m_logPath, m_oldLogPath)) {
+            qWarning() << "Failed to rotate task journal";
+            return;
+        }
+    } else if (!appendLogTo(m_oldLogPath)) {
+        return;
+    }
+
+    const QString snapshotPath = m_snapshotPath;
+    const QString oldLogPath = m_oldLogPath;
+    m_compaction = QtConcurrent::run([snapshotPath, oldLogPath, tasks]() {
+        if (!writeSnapshot(snapshotPath, tasks))
+            return false;
+        QFile::remove(oldLogPath);
+        return true;
+    });
+}
+
+void TaskJournal::waitForCompaction()
+{
+    if (m_compaction.isRunning())
+        m_compaction.waitForFinished();
+}
+
+bool TaskJournal::writeSnapshot(const QString &path, const QVector<Task> &tasks)
+{
+    TRACE_SCOPE_DETAIL("journal", "writeSnapshot", QString::number(tasks.size()));
+    QJsonArray jsonTasks;
+    for (const Task &task : tasks)
+        jsonTasks.append(taskToJson(task));
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to write task snapshot:" << file.errorString();
+        return false;
+    }
+    file.write(QJsonDocument(jsonTasks).toJson());
+    if (!file.commit()) {
+        qWarning() << "Failed to commit task snapshot:" << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+QJsonObject TaskJournal::taskToJson(const Task &task)
+{
+    QJsonObject obj;
+    obj["id"] = task.id;
+    obj["text"] = task.text;
+    obj["date"] = task.date.isValid() ? task.date.toString("dd.MM.yyyy") : QString();
+    obj["tag"] = task.tag;
+    obj["completed"] = task.completed;
+    if (task.isRecurring())
+        obj["rrule"] = task.recurrence;
+    return obj;
+}
+
+Task TaskJournal::taskFromJson(const QJsonObject &obj)
+{
+    Task task;
+    task.id = obj["id"].toInteger();
+    task.text = obj["text"].toString();
+    task.date = QDate::fromString(obj["date"].toString(), "dd.MM.yyyy");
+    task.tag = obj["tag"].toString();
+    task.completed = obj["completed"].toBool(false);
+    task.recurrence = obj["rrule"].toString();
+    return task;
+}
@@ -0,0 +1,61 @@
+#ifndef TASKJOURNAL_H
+#define TASKJOURNAL_H
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QFile>
+#include <QFuture>
+#include <QJsonObject>
+#include "Task.h"
+
+// Журнал изменений задач: снимок (tasks.json) + дописываемый лог.
+// Каждое изменение - одна короткая JSON-строка в логе, снимок
+// переписывается в фоне, когда лог превышает порог.
+class TaskJournal
+{
+public:
+    explicit TaskJournal(const QString &snapshotPath);
+    ~TaskJournal();
+
+    // Снимок + незавершённый лог прошлой компакции + текущий лог.
+    // Только читает: лог открывается (и создаётся) первой записью
+    QVector<Task> load();
+
+    qint64 allocateId() { return m_nextId++; }
+
+    bool appendAdd(const Task &task);
+    bool appendUpdate(const Task &task);
+    bool appendToggle(qint64 id, bool completed);
+    bool appendRemove(qint64 id);
+
+    void setCompactionThreshold(qint64 bytes) { m_compactionThreshold = bytes; }
+    bool needsCompaction() const;
+
+    // Переписывает снимок в фоновом потоке; tasks - текущее состояние
+    void compact(const QVector<Task> &tasks);
+    void waitForCompaction();
+
+    // Запись задачи в формате tasks.json
+    static QJsonObject taskToJson(const Task &task);
+    static Task taskFromJson(const QJsonObject &obj);
+
+private:
+    bool appendRecord(const QJsonObject &record);
+    bool openLog();
+    // Дописывает текущий лог в path и очищает его
+    bool appendLogTo(const QString &path);
+    void replayLog(const QString &path, QVector<Task> &tasks, QHash<qint64, int> &index);
+
+    static bool writeSnapshot(const QString &path, const QVector<Task> &tasks);
+
+    QString m_snapshotPath;
+    QString m_logPath;
+    QString m_oldLogPath;
+    QFile m_log;
+    qint64 m_nextId = 1;
+    qint64 m_compactionThreshold = 256 * 1024;
+    QFuture<bool> m_compaction;
+};
+
+#endif // TASKJOURNAL_H
@@ -0,0 +1,336 @@
+#ifndef TASKMODEL_H
+#define TASKMODEL_H
+
+#include <QAbstractListModel>
+#include <QVector>
+#include <QHash>
+#include <QSet>
+#include <memory>
+#include "Task.h"
+#include "TaskSnapshot.h"
+
+// Плоский список задач для QListView: виджеты на каждую строку не создаются,
+// строки рисует TaskDelegate. Изменения, сделанные пользователем, дублируются
+// сигналами tasksAdded/tasksUpdated/tasksRemoved для хранилища.
+// Строка из двоичного снимка - только номер записи в отображённом файле:
+// поля читаются из снимка при обращении, Task заводится при первом изменении.
+class TaskModel : public QAbstractListModel {
+    Q_OBJECT
+public:
+    enum Roles {
+        TextRole = Qt::UserRole + 1,
+        DateRole,
+        TagRole,
+        CompletedRole,
+        IdRole
+    };
+
+    explicit TaskModel(QObject *parent = nullptr) : QAbstractListModel(parent) {}
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override {
+        return parent.isValid() ? 0 : m_rows.size();
+    }
+
+    QVariant data(const QModelIndex &index, int role) const override {
+        if (!index.isValid() || index.row() >= m_rows.size())
+            return QVariant();
+
+        const qint32 row = m_rows.at(index.row());
+        if (row >= 0) {
+            // Из снимка читается только нужное роли поле
+            switch (role) {
+            case Qt::DisplayRole:
+                return m_snapshot->task(row).displayText();
+            case Qt::EditRole:
+            case TextRole:
+                return m_snapshot->text(row);
+            case Qt::CheckStateRole:
+                return m_snapshot->completed(row) ? Qt::Checked : Qt::Unchecked;
+            case DateRole:
+                return m_snapshot->date(row);
+            case TagRole:
+                return m_snapshot->tag(row);
+            case CompletedRole:
+                return m_snapshot->completed(row);
+            case IdRole:
+                return m_snapshot->id(row);
+            default:
+                return QVariant();
+            }
+        }
+
+        const Task &task = m_owned.at(~row);
+        switch (role) {
+        case Qt::DisplayRole:
+            return task.displayText();
+        case Qt::EditRole:
+        case TextRole:
+            return task.text;
+        case Qt::CheckStateRole:
+            return task.completed ? Qt::Checked : Qt::Unchecked;
+        case DateRole:
+            return task.date;
+        case TagRole:
+            return task.tag;
+        case CompletedRole:
+            return task.completed;
+        case IdRole:
+            return task.id;
+        default:
+            return QVariant();
+        }
+    }
+
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override {
+        if (!index.isValid() || index.row() >= m_rows.size())
+            return false;
+
+        Task &task = editableTask(index.row());
+        const Task before = task;
+        switch (role) {
+        case Qt::EditRole:
+        case TextRole: {
+            QString text = value.toString().trimmed();
+            if (text.isEmpty() || text == task.text)
+                return false;
+            task.text = text;
+            break;
+        }
+        case Qt::CheckStateRole:
+        case CompletedRole: {
+            bool done = (role == Qt::CheckStateRole)
+                            ? value.toInt() == Qt::Checked
+                            : value.toBool();
+            if (done == task.completed)
+                return false;
+            task.completed = done;
+            break;
+        }
+        default:
+            return false;
+        }
+
+        emit dataChanged(index, index);
+        emit tasksUpdated({before}, {task});
+        return true;
+    }
+
+    Qt::ItemFlags flags(const QModelIndex &index) const override {
+        if (!index.isValid())
+            return Qt::NoItemFlags;
+        return Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsEditable | Qt::ItemIsUserCheckable;
+    }
+
+    bool removeRows(int row, int count, const QModelIndex &parent = QModelIndex()) override {
+        if (parent.isValid() || row < 0 || count <= 0 || row + count > m_rows.size())
+            return false;
+
+        const QVector<Task> removed = takeRows(row, count);
+        emit tasksRemoved(removed);
+        return true;
+    }
+
+    void appendTask(const Task &task) {
+        beginInsertRows(QModelIndex(), m_rows.size(), m_rows.size());
+        m_rows.append(own(task));
+        endInsertRows();
+        emit tasksAdded({task});
+    }
+
+    // Порция, прочитанная из хранилища: вставка без сигнала tasksAdded
+    void appendTasks(const QVector<Task> &tasks) {
+        if (tasks.isEmpty())
+            return;
+        beginInsertRows(QModelIndex(), m_rows.size(), m_rows.size() + tasks.size() - 1);
+        m_rows.reserve(m_rows.size() + tasks.size());
+        for (const Task &task : tasks)
+            m_rows.append(own(task));
+        endInsertRows();
+    }
+
+    // Все задачи снимка без сигнала tasksAdded: на строку - номер записи
+    void appendSnapshot(const std::shared_ptr<const TaskSnapshot> &snapshot) {
+        if (!snapshot || snapshot->count() == 0)
+            return;
+        // Строки прежнего снимка переводятся в задачи: модель держит только один
+        if (m_snapshot && m_snapshot != snapshot) {
+            for (int row = 0; row < m_rows.size(); ++row)
+                editableTask(row);
+        }
+
+        beginInsertRows(QModelIndex(), m_rows.size(), m_rows.size() + snapshot->count() - 1);
+        m_rows.reserve(m_rows.size() + snapshot->count());
+        for (int i = 0; i < snapshot->count(); ++i)
+            m_rows.append(i);
+        m_snapshot = snapshot;
+        endInsertRows();
+    }
+
+    // Массовое изменение: задачи ищутся по id за один проход, вид получает
+    // один dataChanged на охватывающий диапазон строк, хранилище - один tasksUpdated
+    void updateTasks(const QVector<Task> &changed) {
+        QHash<qint64, const Task *> byId;
+        byId.reserve(changed.size());
+        for (const Task &task : changed)
+            byId.insert(task.id, &task);
+
+        QVector<Task> before, after;
+        int first = -1, last = -1;
+        for (int row = 0; row < m_rows.size() && !byId.isEmpty(); ++row) {
+            const Task *update = byId.take(idAt(row));
+            if (!update)
+                continue;
+            Task &task = editableTask(row);
+            if (update->text == task.text && update->date == task.date
+                && update->tag == task.tag && update->completed == task.completed
+                && update->recurrence == task.recurrence)
+                continue;
+            before.append(task);
+            task = *update;
+            after.append(task);
+            if (first < 0)
+                first = row;
+            last = row;
+        }
+        if (after.isEmpty())
+            return;
+
+        emit dataChanged(index(first), index(last));
+        emit tasksUpdated(before, after);
+    }
+
+    // Массовое удаление по id; хранилище получает один tasksRemoved.
+    // Несколько подряд идущих диапазонов убираются по одному, россыпь строк -
+    // сбросом модели: прокси не пересчитывает отображение на каждый диапазон
+    void removeTasks(const QSet<qint64> &ids) {
+        static constexpr int MaxRangeRemovals = 32;
+
+        QVector<QPair<int, int>> ranges;   // [first, last] с конца списка
+        for (int row = m_rows.size() - 1; row >= 0; --row) {
+            if (!ids.contains(idAt(row)))
+                continue;
+            const int last = row;
+            while (row > 0 && ids.contains(idAt(row - 1)))
+                --row;
+            ranges.append({row, last});
+        }
+        if (ranges.isEmpty())
+            return;
+
+        QVector<Task> removed;
+        if (ranges.size() <= MaxRangeRemovals) {
+            for (const auto &range : std::as_const(ranges))
+                removed.append(takeRows(range.first, range.second - range.first + 1));
+        } else {
+            QVector<qint32> kept;
+            kept.reserve(m_rows.size());
+            for (int row = 0; row < m_rows.size(); ++row) {
+                if (ids.contains(idAt(row))) {
+                    removed.append(taskAt(row));
+                    release(m_rows.at(row));
+                } else {
+                    kept.append(m_rows.at(row));
+                }
+            }
+            beginResetModel();
+            m_rows = std::move(kept);
+            endResetModel();
+        }
+        emit tasksRemoved(removed);
+    }
+
+    void setTasks(const QVector<Task> &tasks) {
+        beginResetModel();
+        m_owned = tasks;
+        m_freeSlots.clear();
+        m_rows.resize(tasks.size());
+        for (int i = 0; i < tasks.size(); ++i)
+            m_rows[i] = ~i;
+        m_snapshot.reset();
+        endResetModel();
+    }
+
+    // Задача строки целиком, с текстом
+    Task taskAt(int row) const {
+        const qint32 r = m_rows.at(row);
+        return r >= 0 ? m_snapshot->task(r) : m_owned.at(~r);
+    }
+
+    qint64 idAt(int row) const {
+        const qint32 r = m_rows.at(row);
+        return r >= 0 ? m_snapshot->id(r) : m_owned.at(~r).id;
+    }
+
+    // Обход всех задач без текста строк снимка: для индексов и расписаний,
+    // которым нужны id, срок и отметка
+    template <typename Fn>
+    void forEachTask(Fn fn) const {
+        for (qint32 r : m_rows)
+            fn(r >= 0 ? m_snapshot->taskWithoutText(r) : m_owned.at(~r));
+    }
+
+    // Содержимое для TaskSnapshot::write: строки снимка копируются из него без разбора
+    const QVector<qint32> &rows() const { return m_rows; }
+    const QVector<Task> &ownedTasks() const { return m_owned; }
+    const std::shared_ptr<const TaskSnapshot> &snapshot() const { return m_snapshot; }
+
+    int rowOfTask(qint64 id) const {
+        for (int row = 0; row < m_rows.size(); ++row) {
+            if (idAt(row) == id)
+                return row;
+        }
+        return -1;
+    }
+
+signals:
+    void tasksAdded(const QVector<Task> &tasks);
+    void tasksUpdated(const QVector<Task> &before, const QVector<Task> &after);
+    void tasksRemoved(const QVector<Task> &tasks);
+
+private:
+    qint32 own(const Task &task) {
+        if (!m_freeSlots.isEmpty()) {
+            const int slot = m_freeSlots.takeLast();
+            m_owned[slot] = task;
+            return ~slot;
+        }
+        m_owned.append(task);
+        return ~qint32(m_owned.size() - 1);
+    }
+
+    void release(qint32 row) {
+        if (row >= 0)
+            return;
+        m_owned[~row] = Task();
+        m_freeSlots.append(~row);
+    }
+
+    // Строка снимка при первом изменении становится задачей
+    Task &editableTask(int row) {
+        qint32 &r = m_rows[row];
+        if (r >= 0)
+            r = own(m_snapshot->task(r));
+        return m_owned[~r];
+    }
+
+    QVector<Task> takeRows(int row, int count) {
+        QVector<Task> removed;
+        removed.reserve(count);
+        for (int i = row; i < row + count; ++i)
+            removed.append(taskAt(i));
+        beginRemoveRows(QModelIndex(), row, row + count - 1);
+        for (int i = row; i < row + count; ++i)
+            release(m_rows.at(i));
+        m_rows.remove(row, count);
+        endRemoveRows();
+        return removed;
+    }
+
+    // Строка: номер записи m_snapshot (>= 0) или ~номер задачи в m_owned
+    QVector<qint32> m_rows;
+    QVector<Task> m_owned;
+    QVector<int> m_freeSlots;          // освободившиеся места в m_owned
+    std::shared_ptr<const TaskSnapshot> m_snapshot;
+};
+
+#endif // TASKMODEL_H
@@ -0,0 +1,308 @@
+#include "TaskSnapshot.h"
+#include "Trace.h"
+
+#include <QSaveFile>
+#include <QHash>
+#include <QtEndian>
+#include <QDebug>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+const char Magic[4] = {'K', 'T', 'D', 'S'};
+const qint32 NoDate = std::numeric_limits<qint32>::min();
+const quint32 NoTag = 0xFFFFFFFFu;
+const quint32 CompletedFlag = 0x80000000u;
+
+// Все числа в файле - little-endian
+struct Header {
+    char magic[4];
+    quint32 version;
+    qint64 generation;
+    quint32 taskCount;
+    quint32 tagCount;
+    quint64 tagsOffset;     // tagCount пар (offset, length) в пуле: теги и правила повторения
+    quint64 poolOffset;
+};
+static_assert(sizeof(Header) == 40, "snapshot header layout");
+
+struct TagEntry {
+    quint32 offset;
+    quint32 length;
+};
+
+} // namespace
+
+struct TaskSnapshot::Record {
+    qint64 id;
+    qint32 julianDay;       // NoDate - без срока
+    quint32 tag;            // номер в таблице тегов, NoTag - без тега
+    quint32 textOffset;
+    quint32 textLength;     // старший бит - задача выполнена
+    quint32 rule;           // правило повторения в таблице тегов, NoTag - не повторяется
+    quint32 reserved;
+};
+
+bool TaskSnapshot::write(const QString &path, const QVector<Task> &tasks, qint64 generation)
+{
+    QVector<qint32> rows(tasks.size());
+    for (int i = 0; i < tasks.size(); ++i)
+        rows[i] = ~i;
+    return write(path, rows, tasks, nullptr, generation);
+}
+
+bool TaskSnapshot::write(const QString &path, const QVector<qint32> &rows, const QVector<Task> &tasks,
+                         const std::shared_ptr<const TaskSnapshot> &base, qint64 generation)
+{
+    TRACE_SCOPE_DETAIL("snapshot", "write", QString::number(rows.size()));
+
+    QByteArray pool;
+    QVector<Record> records;
+    records.reserve(rows.size());
+    QVector<TagEntry> tags;
+    QHash<QString, quint32> tagIds;
+
+    auto appendBytes = [&pool](const char *data, qsizetype size) {
+        const TagEntry entry{quint32(pool.size()), quint32(size)};
+        pool.append(data, size);
+        return entry;
+    };
+    auto intern = [&](const QString &value) {
+        if (value.isEmpty())
+            return NoTag;
+        auto it = tagIds.constFind(value);
+        if (it == tagIds.constEnd()) {
+            it = tagIds.insert(value, quint32(tags.size()));
+            const QByteArray utf8 = value.toUtf8();
+            tags.append(appendBytes(utf8.constData(), utf8.size()));
+        }
+        return it.value();
+    };
+
+    // Номер в таблице тегов base -> номер в новой таблице, переводится при первой встрече
+    const quint32 Unmapped = NoTag - 1;
+    QVector<quint32> baseTags(base ? base->m_tags.size() : 0, Unmapped);
+    auto internBase = [&](quint32 number) {
+        if (number >= quint32(baseTags.size()))
+            return NoTag;
+        quint32 &mapped = baseTags[number];
+        if (mapped == Unmapped)
+            mapped = intern(base->m_tags.at(number));
+        return mapped;
+    };
+
+    for (qint32 row : rows) {
+        Record record;
+        record.reserved = 0;
+        TagEntry text;
+        quint32 completed = 0;
+        if (row >= 0) {
+            const Record &source = base->record(row);
+            record.id = source.id;
+            record.julianDay = source.julianDay;
+            record.tag = qToLittleEndian(internBase(qFromLittleEndian(source.tag)));
+            record.rule = qToLittleEndian(internBase(qFromLittleEndian(source.rule)));
+            const quint32 offset = qFromLittleEndian(source.textOffset);
+            quint32 length = qFromLittleEndian(source.textLength);
+            completed = length & CompletedFlag;
+            length &= ~CompletedFlag;
+            if (quint64(offset) + length > quint64(base->m_poolSize))
+                length = 0;
+            text = appendBytes(reinterpret_cast<const char *>(base->m_pool + offset), length);
+        } else {
+            const Task &task = tasks.at(~row);
+            record.id = qToLittleEndian(task.id);
+            record.julianDay = qToLittleEndian(task.date.isValid() ? qint32(task.date.toJulianDay()) : NoDate);
+            record.tag = qToLittleEndian(intern(task.tag));
+            record.rule = qToLittleEndian(intern(task.recurrence));
+            const QByteArray utf8 = task.text.toUtf8();
+            text = appendBytes(utf8.constData(), utf8.size());
+            completed = task.completed ? CompletedFlag : 0;
+        }
+
+        if (pool.size() > qsizetype(std::numeric_limits<quint32>::max()) || text.length >= CompletedFlag) {
+            qWarning() << "Failed to write task snapshot: too much text";
+            return false;
+        }
+        record.textOffset = qToLittleEndian(text.offset);
+        record.textLength = qToLittleEndian(text.length | completed);
+        records.append(record);
+    }
+
+    Header header;
+    memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = qToLittleEndian(Version);
+    header.generation = qToLittleEndian(generation);
+    header.taskCount = qToLittleEndian(quint32(records.size()));
+    header.tagCount = qToLittleEndian(quint32(tags.size()));
+    const quint64 tagsOffset = sizeof(Header) + quint64(records.size()) * sizeof(Record);
+    header.tagsOffset = qToLittleEndian(tagsOffset);
+    header.poolOffset = qToLittleEndian(tagsOffset + quint64(tags.size()) * sizeof(TagEntry));
+    for (TagEntry &entry : tags) {
+        entry.offset = qToLittleEndian(entry.offset);
+        entry.length = qToLittleEndian(entry.length);
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to write task snapshot:" << file.errorString();
+        return false;
+    }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(records.constData()), records.size() * sizeof(Record));
+    file.write(reinterpret_cast<const char *>(tags.constData()), tags.size() * sizeof(TagEntry));
+    file.write(pool);
+    if (!file.commit()) {
+        qWarning() << "Failed to commit task snapshot:" << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<const TaskSnapshot> TaskSnapshot::open(const QString &path)
+{
+    TRACE_SCOPE("snapshot", "open");
+
+    std::shared_ptr<TaskSnapshot> snapshot(new TaskSnapshot);
+    snapshot->m_file.setFileName(path);
+    if (!snapshot->m_file.open(QIODevice::ReadOnly))
+        return nullptr;
+
+    snapshot->m_size = snapshot->m_file.size();
+    if (snapshot->m_size < qint64(sizeof(Header)))
+        return nullptr;
+    snapshot->m_data = snapshot->m_file.map(0, snapshot->m_size);
+    if (!snapshot->m_data) {
+        qWarning() << "Failed to map task snapshot:" << snapshot->m_file.errorString();
+        return nullptr;
+    }
+
+    Header header;
+    memcpy(&header, snapshot->m_data, sizeof(header));
+    if (memcmp(header.magic, Magic, sizeof(Magic)) != 0 || qFromLittleEndian(header.version) != Version)
+        return nullptr;
+
+    const quint64 count = qFromLittleEndian(header.taskCount);
+    const quint64 tagCount = qFromLittleEndian(header.tagCount);
+    const quint64 tagsOffset = qFromLittleEndian(header.tagsOffset);
+    const quint64 poolOffset = qFromLittleEndian(header.poolOffset);
+    const quint64 size = quint64(snapshot->m_size);
+    if (count > quint64(std::numeric_limits<int>::max())
+        || tagsOffset != sizeof(Header) + count * sizeof(Record)
+        || poolOffset != tagsOffset + tagCount * sizeof(TagEntry)
+        || poolOffset > size) {
+        qWarning() << "Failed to open task snapshot: corrupt header";
+        return nullptr;
+    }
+
+    snapshot->m_generation = qFromLittleEndian(header.generation);
+    snapshot->m_count = int(count);
+    snapshot->m_pool = snapshot->m_data + poolOffset;
+    snapshot->m_poolSize = qint64(size - poolOffset);
+
+    // Тегов мало, их строки нужны сразу: индекс тегов строится при загрузке
+    snapshot->m_tags.reserve(qsizetype(tagCount));
+    for (quint64 i = 0; i < tagCount; ++i) {
+        TagEntry entry;
+        memcpy(&entry, snapshot->m_data + tagsOffset + i * sizeof(TagEntry), sizeof(entry));
+        snapshot->m_tags.append(snapshot->poolString(qFromLittleEndian(entry.offset),
+                                                     qFromLittleEndian(entry.length)));
+    }
+    return snapshot;
+}
+
+QString TaskSnapshot::nextPath(const QString &path, const std::shared_ptr<const TaskSnapshot> &current)
+{
+    return current && current->fileName() == path ? path + ".1" : path;
+}
+
+std::shared_ptr<const TaskSnapshot> TaskSnapshot::openCurrent(const QString &path, qint64 generation)
+{
+    for (const QString &candidate : {path, path + ".1"}) {
+        std::shared_ptr<const TaskSnapshot> snapshot = open(candidate);
+        if (snapshot && snapshot->generation() == generation)
+            return snapshot;
+    }
+    return nullptr;
+}
+
+TaskSnapshot::~TaskSnapshot()
+{
+    if (m_data)
+        m_file.unmap(const_cast<uchar *>(m_data));
+}
+
+const TaskSnapshot::Record &TaskSnapshot::record(int index) const
+{
+    static_assert(sizeof(Record) == 32, "snapshot record layout");
+    Q_ASSERT(index >= 0 && index < m_count);
+    // Записи выровнены по 8 байт: заголовок 40 байт, запись 32 байта
+    return reinterpret_cast<const Record *>(m_data + sizeof(Header))[index];
+}
+
+QString TaskSnapshot::poolString(quint32 offset, quint32 length) const
+{
+    // Повреждённая ссылка даёт пустую строку, а не чтение за границей файла
+    if (quint64(offset) + length > quint64(m_poolSize))
+        return QString();
+    return QString::fromUtf8(reinterpret_cast<const char *>(m_pool + offset), length);
+}
+
+qint64 TaskSnapshot::id(int index) const
+{
+    return qFromLittleEndian(record(index).id);
+}
+
+bool TaskSnapshot::completed(int index) const
+{
+    return qFromLittleEndian(record(index).textLength) & CompletedFlag;
+}
+
+QDate TaskSnapshot::date(int index) const
+{
+    const qint32 julianDay = qFromLittleEndian(record(index).julianDay);
+    return julianDay == NoDate ? QDate() : QDate::fromJulianDay(julianDay);
+}
+
+QString TaskSnapshot::tag(int index) const
+{
+    const quint32 tag = qFromLittleEndian(record(index).tag);
+    return tag < quint32(m_tags.size()) ? m_tags.at(tag) : QString();
+}
+
+QString TaskSnapshot::text(int index) const
+{
+    const Record &r = record(index);
+    return poolString(qFromLittleEndian(r.textOffset), qFromLittleEndian(r.textLength) & ~CompletedFlag);
+}
+
+QString TaskSnapshot::recurrence(int index) const
+{
+    const quint32 rule = qFromLittleEndian(record(index).rule);
+    return rule < quint32(m_tags.size()) ? m_tags.at(rule) : QString();
+}
+
+int TaskSnapshot::tagNumber(int index) const
+{
+    const quint32 tag = qFromLittleEndian(record(index).tag);
+    return tag < quint32(m_tags.size()) ? int(tag) : -1;
+}
+
+Task TaskSnapshot::task(int index) const
+{
+    Task task = taskWithoutText(index);
+    task.text = text(index);
+    return task;
+}
+
+Task TaskSnapshot::taskWithoutText(int index) const
+{
+    Task task;
+    task.id = id(index);
+    task.date = date(index);
+    task.tag = tag(index);
+    task.completed = completed(index);
+    task.recurrence = recurrence(index);
+    return task;
+}
@@ -0,0 +1,76 @@
+#ifndef TASKSNAPSHOT_H
+#define TASKSNAPSHOT_H
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include <memory>
+#include "Task.h"
+
+// Двоичный снимок задач для быстрого запуска: заголовок, записи
+// фиксированной длины, таблица тегов и общий пул строк UTF-8.
+// Файл отображается в память (QFile::map); теги читаются при открытии,
+// текст задачи - только при обращении к ней. Снимок помечен номером
+// состояния базы (DatabaseManager::tasksGeneration) и годен, пока тот не изменился.
+class TaskSnapshot
+{
+public:
+    // Версии формата: 1 - запись 24 байта (id, срок, тег, текст);
+    // 2 - запись 32 байта, добавлено правило повторения (RRULE)
+    static constexpr quint32 Version = 2;
+
+    // Атомарная запись через QSaveFile
+    static bool write(const QString &path, const QVector<Task> &tasks, qint64 generation);
+    // Строки нового снимка: номер записи base (>= 0) или ~номер задачи в tasks.
+    // Записи base копируются вместе с байтами текста, без разбора UTF-8
+    static bool write(const QString &path, const QVector<qint32> &rows, const QVector<Task> &tasks,
+                      const std::shared_ptr<const TaskSnapshot> &base, qint64 generation);
+    // nullptr, если файла нет или он не прошёл проверку
+    static std::shared_ptr<const TaskSnapshot> open(const QString &path);
+
+    // Снимок приложения чередуется между двумя файлами, path и path + ".1":
+    // новый пишется в тот, что не отображён текущим снимком (на Windows
+    // отображённый в память файл нельзя заменить переименованием)
+    static QString nextPath(const QString &path, const std::shared_ptr<const TaskSnapshot> &current);
+    // Тот из двух файлов, что помечен номером generation; nullptr - такого нет
+    static std::shared_ptr<const TaskSnapshot> openCurrent(const QString &path, qint64 generation);
+
+    ~TaskSnapshot();
+
+    QString fileName() const { return m_file.fileName(); }
+    qint64 generation() const { return m_generation; }
+    int count() const { return m_count; }
+
+    qint64 id(int index) const;
+    bool completed(int index) const;
+    QDate date(int index) const;
+    QString tag(int index) const;
+    QString recurrence(int index) const;
+    // Номер тега в таблице снимка, -1 - без тега; для построения индекса тегов
+    int tagNumber(int index) const;
+    int tagCount() const { return m_tags.size(); }
+    QString tagName(int number) const { return m_tags.at(number); }
+    Task task(int index) const;
+    QString text(int index) const;
+    // Задача без текста: всё, что нужно индексам и фильтрам
+    Task taskWithoutText(int index) const;
+
+private:
+    TaskSnapshot() = default;
+    Q_DISABLE_COPY(TaskSnapshot)
+
+    struct Record;
+    const Record &record(int index) const;
+    QString poolString(quint32 offset, quint32 length) const;
+
+    QFile m_file;
+    const uchar *m_data = nullptr;
+    qint64 m_size = 0;
+    qint64 m_generation = -1;
+    int m_count = 0;
+    const uchar *m_pool = nullptr;
+    qint64 m_poolSize = 0;
+    QVector<QString> m_tags;
+};
+
+#endif // TASKSNAPSHOT_H
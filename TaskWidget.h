@@ -6,129 +6,262 @@
 #include <QLabel>
 #include <QLineEdit>
 #include <QPushButton>
-#include <QScrollArea>
+#include <QListView>
 #include <QCalendarWidget>
 #include <QInputDialog>
 #include <QDialog>
 #include <QDialogButtonBox>
 #include <QDate>
-#include <QFrame>
 #include <QHBoxLayout>
 #include <QComboBox>
-#include <QCheckBox>
 #include <QSet>
-#include <QFile>
-#include <QJsonDocument>
-#include <QJsonArray>
-#include <QJsonObject>
+#include <algorithm>
 #include <QMessageBox>
+#include <QCoreApplication>
+#include "TaskModel.h"
+#include "TaskDelegate.h"
+#include "TaskFilterProxyModel.h"
+#include "TagIndex.h"
+#include "AsyncDatabase.h"
+#include "Trace.h"
 
 class TaskWidget : public QWidget {
     Q_OBJECT
 public:
-    TaskWidget(QWidget *parent = nullptr) : QWidget(parent) {
+    TaskWidget(AsyncDatabase *db, QWidget *parent = nullptr) : QWidget(parent), db(db) {
         QVBoxLayout *mainLayout = new QVBoxLayout(this);
 
         QLabel *title = new QLabel("📋 Задачи");
         title->setAlignment(Qt::AlignCenter);
-        title->setStyleSheet("font-size: 24px; font-weight: bold;");
+        title->setProperty("role", "pageTitle");
         mainLayout->addWidget(title);
 
+        // Список тегов ведёт индекс: строка добавляется с первой задачей тега
+        // и убирается с последней. В поле можно ввести выражение: & | ! ( )
+        tagIndex = new TagIndex(this);
         tagFilterCombo = new QComboBox;
+        tagFilterCombo->setEditable(true);
+        tagFilterCombo->setInsertPolicy(QComboBox::NoInsert);
+        tagFilterCombo->setToolTip("Тег или выражение из тегов: работа & !срочно | дом");
         tagFilterCombo->addItem("Все теги");
-        tagFilterCombo->setStyleSheet(
-            "QComboBox {"
-            "  font-size: 14px;"
-            "  padding: 4px 8px;"
-            "  background-color: #1e1e1e;"
-            "  color: white;"
-            "  border: 1px solid #555555;"
-            "  border-radius: 6px;"
-            "}"
-            "QComboBox:hover { border-color: #0078d7; }"
-            );
         mainLayout->addWidget(tagFilterCombo);
         connect(tagFilterCombo, &QComboBox::currentTextChanged, this, &TaskWidget::filterTasksByTag);
+        connect(tagIndex, &TagIndex::tagAdded, tagFilterCombo, [this](const QString &tag) {
+            tagFilterCombo->addItem(tag);
+        });
+        connect(tagIndex, &TagIndex::tagRemoved, tagFilterCombo, [this](const QString &tag) {
+            const int idx = tagFilterCombo->findText(tag, Qt::MatchExactly | Qt::MatchCaseSensitive);
+            if (idx > 0)
+                tagFilterCombo->removeItem(idx);
+        });
 
         QHBoxLayout *inputLayout = new QHBoxLayout;
         taskInput = new QLineEdit;
         taskInput->setPlaceholderText("Введите новую задачу...");
-        taskInput->setStyleSheet(
-            "QLineEdit {"
-            "  background-color: #1e1e1e;"
-            "  color: #ffffff;"
-            "  font-size: 16px;"
-            "  padding: 8px 12px;"
-            "  border: 2px solid #3a3a3a;"
-            "  border-radius: 8px;"
-            "}"
-            "QLineEdit:focus {"
-            "  border-color: #0078d7;"
-            "  background-color: #252526;"
-            "}"
-            "QLineEdit:hover {"
-            "  border-color: #555555;"
-            "}"
-            );
         inputLayout->addWidget(taskInput);
 
         QPushButton *dateBtn = new QPushButton("📅");
         QPushButton *tagBtn = new QPushButton("🏷");
+        QPushButton *repeatBtn = new QPushButton("🔁");
+        repeatBtn->setToolTip("Повторять задачу");
         QPushButton *addBtn = new QPushButton("➕");
 
         inputLayout->addWidget(dateBtn);
         inputLayout->addWidget(tagBtn);
+        inputLayout->addWidget(repeatBtn);
         inputLayout->addWidget(addBtn);
 
         mainLayout->addLayout(inputLayout);
 
-        scrollArea = new QScrollArea;
-        scrollArea->setWidgetResizable(true);
-
-        containerWidget = new QWidget;
-        taskLayout = new QVBoxLayout(containerWidget);
-        taskLayout->setAlignment(Qt::AlignTop);
-        containerWidget->setLayout(taskLayout);
-
-        scrollArea->setWidget(containerWidget);
-        mainLayout->addWidget(scrollArea);
+        // Список задач: модель + делегат, виджеты создаются только для редактируемой строки
+        taskModel = new TaskModel(this);
+        filterModel = new TaskFilterProxyModel(tagIndex, this);
+        filterModel->setSourceModel(taskModel);
+
+        TaskDelegate *delegate = new TaskDelegate(this);
+
+        taskView = new QListView;
+        taskView->setModel(filterModel);
+        taskView->setItemDelegate(delegate);
+        taskView->setUniformItemSizes(true);
+        taskView->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+        taskView->setEditTriggers(QAbstractItemView::DoubleClicked | QAbstractItemView::EditKeyPressed);
+        taskView->setSelectionMode(QAbstractItemView::ExtendedSelection);
+        mainLayout->addWidget(taskView);
+
+        // Действия над выделением (Shift/Ctrl - диапазоны, Ctrl+A - все видимые):
+        // одна транзакция в базе, одно обновление индекса тегов и списка
+        QHBoxLayout *bulkLayout = new QHBoxLayout;
+        selectionLabel = new QLabel;
+        selectionLabel->setProperty("role", "status");
+        QPushButton *selectAllBtn = new QPushButton("☑");
+        selectAllBtn->setToolTip("Выделить все видимые задачи");
+        bulkCompleteBtn = new QPushButton("✅");
+        bulkCompleteBtn->setToolTip("Отметить выполненными (или снять отметку, если все выполнены)");
+        bulkTagBtn = new QPushButton("🏷");
+        bulkTagBtn->setToolTip("Сменить тег выделенных задач");
+        bulkDateBtn = new QPushButton("📅");
+        bulkDateBtn->setToolTip("Сменить срок выделенных задач");
+        bulkRemoveBtn = new QPushButton("🗑");
+        bulkRemoveBtn->setToolTip("Удалить выделенные задачи");
+        bulkLayout->addWidget(selectionLabel, 1);
+        bulkLayout->addWidget(selectAllBtn);
+        bulkLayout->addWidget(bulkCompleteBtn);
+        bulkLayout->addWidget(bulkTagBtn);
+        bulkLayout->addWidget(bulkDateBtn);
+        bulkLayout->addWidget(bulkRemoveBtn);
+        mainLayout->addLayout(bulkLayout);
+
+        connect(selectAllBtn, &QPushButton::clicked, taskView, &QListView::selectAll);
+        connect(bulkCompleteBtn, &QPushButton::clicked, this, &TaskWidget::completeSelected);
+        connect(bulkTagBtn, &QPushButton::clicked, this, &TaskWidget::retagSelected);
+        connect(bulkDateBtn, &QPushButton::clicked, this, &TaskWidget::redateSelected);
+        connect(bulkRemoveBtn, &QPushButton::clicked, this, &TaskWidget::removeSelected);
+        connect(taskView->selectionModel(), &QItemSelectionModel::selectionChanged,
+                this, &TaskWidget::updateSelectionActions);
+        connect(filterModel, &QAbstractItemModel::modelReset, this, &TaskWidget::updateSelectionActions);
+        connect(filterModel, &QAbstractItemModel::rowsRemoved, this, &TaskWidget::updateSelectionActions);
+        updateSelectionActions();
+
+        // Ход загрузки; список уже можно фильтровать и пополнять
+        loadingLabel = new QLabel;
+        loadingLabel->setAlignment(Qt::AlignCenter);
+        loadingLabel->setProperty("role", "status");
+        loadingLabel->hide();
+        mainLayout->addWidget(loadingLabel);
+
+        connect(delegate, &TaskDelegate::editRequested, taskView, [this](const QModelIndex &index) {
+            taskView->edit(index);
+        });
+        connect(delegate, &TaskDelegate::removeRequested, this, &TaskWidget::removeTaskAt);
+
+        // Изменения и удаления копит отложенное сохранение AsyncDatabase:
+        // серия правок или массовое действие уходит в базу одной транзакцией
+        connect(taskModel, &TaskModel::tasksUpdated, this,
+                [this](const QVector<Task> &before, const QVector<Task> &after) {
+            bool retagged = false;
+            for (int i = 0; i < after.size(); ++i) {
+                if (before.at(i).tag != after.at(i).tag) {
+                    tagIndex->setTaskTag(after.at(i).id, after.at(i).tag);
+                    retagged = true;
+                }
+                this->db->scheduleTaskUpdate(after.at(i));
+            }
+            if (retagged)
+                filterModel->refreshFilter();
+        });
+        connect(taskModel, &TaskModel::tasksRemoved, this, [this](const QVector<Task> &removed) {
+            for (const Task &task : removed) {
+                tagIndex->removeTask(task.id);
+                this->db->scheduleTaskRemoval(task.id);
+            }
+        });
 
         connect(dateBtn, &QPushButton::clicked, this, &TaskWidget::openDatePopup);
         connect(tagBtn, &QPushButton::clicked, this, &TaskWidget::openTagPopup);
+        connect(repeatBtn, &QPushButton::clicked, this, &TaskWidget::openRecurrencePopup);
         connect(addBtn, &QPushButton::clicked, this, &TaskWidget::addTask);
+        connect(db, &AsyncDatabase::taskStreamStarted, this, [this](int requestId, int total) {
+            if (requestId != loadRequestId)
+                return;
+            loadTotal = total;
+            updateLoadingLabel();
+        });
+        connect(db, &AsyncDatabase::taskBatchReady, this, &TaskWidget::appendLoadedBatch);
+        // Сохранение повторяется само; предупреждение - одно на серию неудач
+        connect(db, &AsyncDatabase::taskChangesSaved, this, [this](bool ok) {
+            if (ok) {
+                saveFailureShown = false;
+            } else if (!saveFailureShown) {
+                saveFailureShown = true;
+                QMessageBox::warning(this, "Ошибка",
+                                     "Не удалось сохранить изменения задач, сохранение будет повторено.");
+            }
+        });
 
-        loadTasksFromFile();
+        // Снимок для следующего запуска пишется при выходе, если задачи менялись
+        auto markChanged = [this]() { changedSinceLoad = true; };
+        connect(taskModel, &TaskModel::tasksAdded, this, markChanged);
+        connect(taskModel, &TaskModel::tasksUpdated, this, markChanged);
+        connect(taskModel, &TaskModel::tasksRemoved, this, markChanged);
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, &TaskWidget::saveSnapshot);
+
+        loadTasks();
     }
 
-private:
-    struct TaskItem {
-        QString text;
-        QString date;
-        QString tag;
-        bool completed = false;
-
-        QFrame *frame = nullptr;
-        QLabel *label = nullptr;
-        QLineEdit *edit = nullptr;
-        QPushButton *editBtn = nullptr;
-        QPushButton *saveBtn = nullptr;
-        QPushButton *removeBtn = nullptr;
-        QCheckBox *checkBox = nullptr;
-    };
+    // Выделение задачи в списке (например, из результатов поиска);
+    // во время загрузки откладывается до последней порции
+    void showTask(qint64 id) {
+        if (loading) {
+            pendingShowId = id;
+            return;
+        }
+        const int row = taskModel->rowOfTask(id);
+        if (row < 0)
+            return;
+        QModelIndex index = filterModel->mapFromSource(taskModel->index(row));
+        if (!index.isValid()) {
+            // Задача скрыта фильтром по тегу
+            tagFilterCombo->setCurrentIndex(0);
+            index = filterModel->mapFromSource(taskModel->index(row));
+        }
+        taskView->setCurrentIndex(index);
+        taskView->scrollTo(index, QAbstractItemView::PositionAtCenter);
+    }
 
+    TaskModel *model() const { return taskModel; }
+
+    ~TaskWidget() override {
+        if (loading)
+            db->cancelTaskStream(loadRequestId);
+    }
+
+signals:
+    void loadFinished();
+
+private:
+    AsyncDatabase *db;
     QLineEdit *taskInput;
-    QScrollArea *scrollArea;
-    QWidget *containerWidget;
-    QVBoxLayout *taskLayout;
-    QString selectedDate;
+    QListView *taskView;
+    TaskModel *taskModel;
+    TaskFilterProxyModel *filterModel;
+    TagIndex *tagIndex;
+    QDate selectedDate;
     QString selectedTag;
+    QString selectedRecurrence;
     QComboBox *tagFilterCombo;
-
-    QList<TaskItem*> tasks;
-
-    const QString tasksFile = "tasks.json";
+    QString activeFilterTag = "Все теги";
+    QLabel *selectionLabel;
+    QPushButton *bulkCompleteBtn;
+    QPushButton *bulkTagBtn;
+    QPushButton *bulkDateBtn;
+    QPushButton *bulkRemoveBtn;
+
+    // Порционная загрузка с потока чтения
+    static constexpr int LoadBatchSize = 500;
+    int loadRequestId = 0;
+    bool loading = false;
+    int loadedCount = 0;
+    int loadTotal = -1;
+    QLabel *loadingLabel;
+    QSet<qint64> loadedIds;     // задачи, уже попавшие в модель за время загрузки
+    qint64 pendingShowId = -1;
+
+    // Двоичный снимок задач рядом с базой, см. TaskSnapshot
+    static constexpr const char *SnapshotPath = "tasks.snapshot";
+    bool loadedFromSnapshot = false;
+    bool changedSinceLoad = false;
+    bool saveFailureShown = false;
+    struct SnapshotLoad {
+        std::shared_ptr<const TaskSnapshot> snapshot;
+        TagIndex::Batch tags;
+    };
 
     void openDatePopup() {
+        pickDate(selectedDate);
+    }
+
+    bool pickDate(QDate &date) {
         QDialog dialog(this);
         dialog.setWindowTitle("Выберите дату");
 
@@ -139,13 +272,15 @@ private:
         QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
         layout->addWidget(buttons);
 
-        connect(buttons, &QDialogButtonBox::accepted, [&]() {
-            selectedDate = calendar->selectedDate().toString("dd.MM.yyyy");
-            dialog.accept();
-        });
+        if (date.isValid())
+            calendar->setSelectedDate(date);
+        connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
         connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
 
-        dialog.exec();
+        if (dialog.exec() != QDialog::Accepted)
+            return false;
+        date = calendar->selectedDate();
+        return true;
     }
 
     void openTagPopup() {
@@ -156,6 +291,46 @@ private:
         }
     }
 
+    // Готовые правила и своё правило в синтаксисе RRULE
+    void openRecurrencePopup() {
+        static const QList<QPair<QString, QString>> presets = {
+            {"Не повторять", QString()},
+            {"Каждый день", "FREQ=DAILY"},
+            {"По будням", "FREQ=WEEKLY;BYDAY=MO,TU,WE,TH,FR"},
+            {"Каждую неделю", "FREQ=WEEKLY"},
+            {"Каждые 2 недели", "FREQ=WEEKLY;INTERVAL=2"},
+            {"Каждый месяц", "FREQ=MONTHLY"},
+            {"В последний день месяца", "FREQ=MONTHLY;BYMONTHDAY=-1"},
+            {"Каждый год", "FREQ=YEARLY"},
+            {"Своё правило...", QString()}
+        };
+        QStringList names;
+        for (const auto &preset : presets)
+            names.append(preset.first);
+
+        bool ok;
+        const QString name = QInputDialog::getItem(this, "Повторение", "Повторять:", names, 0, false, &ok);
+        if (!ok)
+            return;
+        const int choice = names.indexOf(name);
+        if (choice < presets.size() - 1) {
+            selectedRecurrence = presets.at(choice).second;
+            return;
+        }
+
+        const QString rule = QInputDialog::getText(this, "Повторение", "Правило RRULE:", QLineEdit::Normal,
+                                                   selectedRecurrence.isEmpty() ? "FREQ=WEEKLY;BYDAY=MO"
+                                                                                : selectedRecurrence, &ok);
+        if (!ok || rule.trimmed().isEmpty())
+            return;
+        const Recurrence recurrence = Recurrence::parse(rule);
+        if (!recurrence.isValid()) {
+            QMessageBox::warning(this, "Ошибка", "Правило не распознано.");
+            return;
+        }
+        selectedRecurrence = recurrence.toString();
+    }
+
     void addTask() {
         QString text = taskInput->text().trimmed();
         if (text.isEmpty()) {
@@ -163,207 +338,239 @@ private:
             return;
         }
 
-        addTaskItem(text, selectedDate, selectedTag, false);
-
-        updateTagFilter();
+        // Повторения отсчитываются от срока; без срока серия начинается сегодня
+        QDate date = selectedDate;
+        if (!selectedRecurrence.isEmpty() && !date.isValid())
+            date = QDate::currentDate();
+        addTaskItem(text, date, selectedTag, false, selectedRecurrence);
 
         taskInput->clear();
-        selectedDate.clear();
+        selectedDate = QDate();
         selectedTag.clear();
-
-        filterTasksByTag(tagFilterCombo->currentText());
-
-        saveTasksToFile();
+        selectedRecurrence.clear();
     }
 
-    void addTaskItem(const QString &text, const QString &date, const QString &tag, bool completed) {
-        QString fullText = text;
-        if (!date.isEmpty()) fullText += "  ⏰ " + date;
-        if (!tag.isEmpty()) fullText += "  🏷 " + tag;
-
-        QFrame *taskFrame = new QFrame;
-        taskFrame->setFrameShape(QFrame::Box);
-        taskFrame->setStyleSheet("background-color: #2e2e2e; border-radius: 10px; padding: 10px;");
-        QHBoxLayout *taskRow = new QHBoxLayout(taskFrame);
-
-        QCheckBox *checkBox = new QCheckBox;
-        checkBox->setChecked(completed);
-        taskRow->addWidget(checkBox);
-
-        QLabel *taskLabel = new QLabel(fullText);
-        taskLabel->setStyleSheet("color: white; font-size: 16px;");
-        if (completed) {
-            taskLabel->setStyleSheet("color: gray; font-size: 16px; text-decoration: line-through;");
-        }
-        taskRow->addWidget(taskLabel);
-
-        QLineEdit *taskEdit = new QLineEdit(fullText);
-        taskEdit->setStyleSheet(
-            "QLineEdit {"
-            "  background-color: #1e1e1e;"
-            "  color: #ffffff;"
-            "  font-size: 16px;"
-            "  padding: 6px 8px;"
-            "  border: 1px solid #555555;"
-            "  border-radius: 6px;"
-            "}"
-            );
-        taskEdit->setVisible(false);
-        taskRow->addWidget(taskEdit);
-
-        QPushButton *editBtn = new QPushButton("✏️");
-        QPushButton *saveBtn = new QPushButton("💾");
-        QPushButton *removeBtn = new QPushButton("❌");
-
-        saveBtn->setEnabled(false);
-        saveBtn->setVisible(false);
-
-        editBtn->setFixedSize(30,30);
-        saveBtn->setFixedSize(30,30);
-        removeBtn->setFixedSize(30,30);
-
-        taskRow->addWidget(editBtn);
-        taskRow->addWidget(saveBtn);
-        taskRow->addWidget(removeBtn);
-
-        taskLayout->addWidget(taskFrame);
-
-        TaskItem *item = new TaskItem;
-        item->text = text;
-        item->date = date;
-        item->tag = tag;
-        item->completed = completed;
-        item->frame = taskFrame;
-        item->label = taskLabel;
-        item->edit = taskEdit;
-        item->editBtn = editBtn;
-        item->saveBtn = saveBtn;
-        item->removeBtn = removeBtn;
-        item->checkBox = checkBox;
-
-        tasks.append(item);
-
-        connect(checkBox, &QCheckBox::stateChanged, this, [this, item](int state){
-            bool done = (state == Qt::Checked);
-            item->completed = done;
-            if (done) {
-                item->label->setStyleSheet("color: gray; font-size: 16px; text-decoration: line-through;");
-            } else {
-                item->label->setStyleSheet("color: white; font-size: 16px; text-decoration: none;");
+    void addTaskItem(const QString &text, const QDate &date, const QString &tag, bool completed,
+                     const QString &recurrence = QString()) {
+        Task task;
+        task.text = text;
+        task.date = date;
+        task.tag = tag;
+        task.completed = completed;
+        task.recurrence = recurrence;
+
+        // Строка появляется в списке, когда база выдала ей id
+        db->write([task](DatabaseManager &m) {
+            return m.addTask(task.text, task.date, task.tag, task.completed, task.recurrence);
+        }).then(this, [this, task](qint64 id) mutable {
+            if (id < 0) {
+                QMessageBox::warning(this, "Ошибка", "Не удалось сохранить задачу.");
+                return;
             }
-            saveTasksToFile();
+            task.id = id;
+            if (loading)
+                loadedIds.insert(task.id);
+            // Индекс обновляется раньше модели: прокси проверяет новую строку по нему
+            tagIndex->addTask(task.id, task.tag);
+            taskModel->appendTask(task);
         });
+    }
 
-        connect(editBtn, &QPushButton::clicked, this, [item]() {
-            item->label->setVisible(false);
-            item->edit->setVisible(true);
-            item->edit->setFocus();
-            item->editBtn->setVisible(false);
-            item->saveBtn->setVisible(true);
-            item->saveBtn->setEnabled(true);
-        });
+    void removeTaskAt(const QModelIndex &index) {
+        filterModel->removeRow(index.row());
+    }
 
-        connect(saveBtn, &QPushButton::clicked, this, [this, item]() {
-            QString newText = item->edit->text().trimmed();
-            if (newText.isEmpty()) {
-                QMessageBox::warning(this, "Ошибка", "Задача не может быть пустой!");
-                return;
-            }
+    QVector<Task> selectedTasks() const {
+        const QModelIndexList rows = taskView->selectionModel()->selectedRows();
+        QVector<Task> tasks;
+        tasks.reserve(rows.size());
+        for (const QModelIndex &index : rows)
+            tasks.append(taskModel->taskAt(filterModel->mapToSource(index).row()));
+        return tasks;
+    }
 
-            item->label->setText(newText);
-            item->label->setVisible(true);
-            item->edit->setVisible(false);
-            item->editBtn->setVisible(true);
-            item->saveBtn->setVisible(false);
+    void updateSelectionActions() {
+        const int count = taskView->selectionModel()->selectedRows().size();
+        selectionLabel->setText(count > 0 ? QString("Выбрано: %1").arg(count) : QString());
+        for (QPushButton *button : {bulkCompleteBtn, bulkTagBtn, bulkDateBtn, bulkRemoveBtn})
+            button->setEnabled(count > 0);
+    }
 
-            item->text = newText;
+    // Изменяет копии выделенных задач и отдаёт их модели одним вызовом
+    template <typename Change>
+    void updateSelected(Change change) {
+        TRACE_SCOPE("bulk", "updateSelected");
+        QVector<Task> tasks = selectedTasks();
+        for (Task &task : tasks)
+            change(task);
+        taskModel->updateTasks(tasks);
+    }
 
-            saveTasksToFile();
+    void completeSelected() {
+        const QVector<Task> tasks = selectedTasks();
+        const bool done = !std::all_of(tasks.cbegin(), tasks.cend(), [](const Task &task) {
+            return task.completed;
         });
+        updateSelected([done](Task &task) { task.completed = done; });
+    }
 
-        connect(removeBtn, &QPushButton::clicked, this, [this, item]() {
-            tasks.removeOne(item);
-            item->frame->deleteLater();
-            delete item;
-
-            updateTagFilter();
-            filterTasksByTag(tagFilterCombo->currentText());
+    void retagSelected() {
+        bool ok;
+        const QString tag = QInputDialog::getText(this, "Тег выделенных задач", "Тег (пусто - без тега):",
+                                                  QLineEdit::Normal, "", &ok).trimmed();
+        if (ok)
+            updateSelected([tag](Task &task) { task.tag = tag; });
+    }
 
-            saveTasksToFile();
-        });
+    void redateSelected() {
+        QDate date;
+        if (pickDate(date))
+            updateSelected([date](Task &task) { task.date = date; });
     }
 
-    void updateTagFilter() {
-        QSet<QString> tags;
-        for (TaskItem *task : qAsConst(tasks)) {
-            if (!task->tag.isEmpty()) tags.insert(task->tag);
-        }
-        QString current = tagFilterCombo->currentText();
+    void removeSelected() {
+        const QVector<Task> tasks = selectedTasks();
+        if (tasks.size() > 1
+            && QMessageBox::question(this, "Удаление", QString("Удалить выбранные задачи (%1)?").arg(tasks.size()))
+                   != QMessageBox::Yes)
+            return;
 
-        tagFilterCombo->blockSignals(true);
-        tagFilterCombo->clear();
-        tagFilterCombo->addItem("Все теги");
-        for (const QString &tag : tags) {
-            tagFilterCombo->addItem(tag);
-        }
-        int idx = tagFilterCombo->findText(current);
-        if (idx >= 0) {
-            tagFilterCombo->setCurrentIndex(idx);
-        }
-        tagFilterCombo->blockSignals(false);
+        TRACE_SCOPE("bulk", "removeSelected");
+        QSet<qint64> ids;
+        ids.reserve(tasks.size());
+        for (const Task &task : tasks)
+            ids.insert(task.id);
+        taskModel->removeTasks(ids);
     }
 
     void filterTasksByTag(const QString &tag) {
-        for (TaskItem *task : tasks) {
-            bool visible = (tag == "Все теги") || (task->tag == tag);
-            task->frame->setVisible(visible);
-        }
+        // Прокси сам фильтрует вставленные строки, пересчёт нужен только при смене выражения
+        if (tag == activeFilterTag) return;
+        activeFilterTag = tag;
+
+        // Тег из списка берётся как есть, введённый текст - как выражение;
+        // незаконченное выражение при вводе оставляет прежний фильтр
+        if (tag == "Все теги")
+            filterModel->setTagExpression(QString());
+        else if (tagFilterCombo->findText(tag, Qt::MatchExactly | Qt::MatchCaseSensitive) > 0)
+            filterModel->setTag(tag);
+        else
+            filterModel->setTagExpression(tag);
     }
 
-    void saveTasksToFile() {
-        QJsonArray jsonTasks;
-        for (TaskItem *task : qAsConst(tasks)) {
-            QJsonObject obj;
-            obj["text"] = task->text;
-            obj["date"] = task->date;
-            obj["tag"] = task->tag;
-            obj["completed"] = task->completed;
-            jsonTasks.append(obj);
-        }
+    void loadTasks() {
+        taskModel->setTasks({});
+        tagIndex->clear();
+        loadedIds.clear();
+        if (loading)
+            db->cancelTaskStream(loadRequestId);
+        loading = true;
+        loadedCount = 0;
+        loadTotal = -1;
+        loadRequestId = 0;
+        loadedFromSnapshot = false;
+        updateLoadingLabel();
+
+        // Актуальный снимок открывается за миллисекунды, множества тегов по его
+        // столбцу тегов собираются тут же в потоке чтения; иначе задачи
+        // читаются из базы порциями
+        db->read([](DatabaseManager &m) {
+            SnapshotLoad load;
+            load.snapshot = TaskSnapshot::openCurrent(SnapshotPath, m.tasksGeneration());
+            if (load.snapshot)
+                load.tags = TagIndex::batchFromSnapshot(*load.snapshot);
+            return load;
+        }).then(this, [this](const SnapshotLoad &load) {
+            if (load.snapshot)
+                loadSnapshot(load);
+            else
+                loadRequestId = db->streamTasks(LoadBatchSize);
+        });
+    }
 
-        QJsonDocument doc(jsonTasks);
-        QFile file(tasksFile);
-        if (file.open(QIODevice::WriteOnly)) {
-            file.write(doc.toJson());
-            file.close();
-        }
+    // Задачи, добавленные во время загрузки, в снимок попасть не могут:
+    // добавление меняет номер состояния, и такой снимок был бы отвергнут
+    void loadSnapshot(const SnapshotLoad &load) {
+        TRACE_SCOPE("snapshot", "loadSnapshot");
+        tagIndex->addBatch(load.tags);
+        taskModel->appendSnapshot(load.snapshot);
+        loadedCount = load.snapshot->count();
+        loadedFromSnapshot = true;
+        finishLoading();
     }
 
-    void loadTasksFromFile() {
-        QFile file(tasksFile);
-        if (!file.exists()) return;
-        if (!file.open(QIODevice::ReadOnly)) return;
+    void saveSnapshot() {
+        // Прочитанный из актуального снимка и не изменённый список переписывать незачем
+        if (loading || (loadedFromSnapshot && !changedSinceLoad))
+            return;
+        // Неизменённые строки снимка копируются из отображённого файла как есть.
+        // Запись идёт после отложенных изменений; если они не сохранились,
+        // список расходится с базой и снимок с её номером состояния не пишется
+        const QVector<qint32> rows = taskModel->rows();
+        const QVector<Task> tasks = taskModel->ownedTasks();
+        const std::shared_ptr<const TaskSnapshot> base = taskModel->snapshot();
+        const QFuture<bool> flushed = db->flushTaskChanges();
+        AsyncDatabase *async = db;
+        db->write([rows, tasks, base, flushed, async](DatabaseManager &m) {
+            if (!flushed.result() || !async->taskChangesSettled()) {
+                qWarning() << "Task snapshot skipped: task changes are not saved";
+                return false;
+            }
+            const qint64 generation = m.tasksGeneration();
+            return generation >= 0
+                && TaskSnapshot::write(TaskSnapshot::nextPath(SnapshotPath, base), rows, tasks, base, generation);
+        });
+    }
 
-        QByteArray data = file.readAll();
-        file.close();
+    void finishLoading() {
+        loading = false;
+        loadedIds.clear();
+        emit loadFinished();
+        if (pendingShowId >= 0) {
+            showTask(pendingShowId);
+            pendingShowId = -1;
+        }
+        updateLoadingLabel();
+    }
 
-        QJsonDocument doc = QJsonDocument::fromJson(data);
-        if (!doc.isArray()) return;
+    void updateLoadingLabel() {
+        if (!loading) {
+            loadingLabel->hide();
+            return;
+        }
+        loadingLabel->setText(loadTotal < 0
+                                  ? QString("Загрузка...")
+                                  : QString("Загрузка %1/%2").arg(loadedCount).arg(loadTotal));
+        loadingLabel->show();
+    }
 
-        QJsonArray jsonTasks = doc.array();
-        for (const QJsonValue &val : jsonTasks) {
-            if (!val.isObject()) continue;
-            QJsonObject obj = val.toObject();
-            QString text = obj["text"].toString();
-            QString date = obj["date"].toString();
-            QString tag = obj["tag"].toString();
-            bool completed = obj["completed"].toBool(false);
+    void appendLoadedBatch(int requestId, QVector<Task> batch, bool last) {
+        if (requestId != loadRequestId || !loading)
+            return;
 
-            addTaskItem(text, date, tag, completed);
+        // Строка уже в модели, если задачу добавили во время загрузки или
+        // перенесли (сменился срок) после того, как она пришла в прежней порции:
+        // курсор встречает её снова на новом месте порядка (date, id).
+        // Удалённые из модели id тоже остаются в множестве, пока удаление не записано
+        batch.erase(std::remove_if(batch.begin(), batch.end(), [this](const Task &task) {
+            return loadedIds.contains(task.id);
+        }), batch.end());
+        for (const Task &task : std::as_const(batch)) {
+            loadedIds.insert(task.id);
+            tagIndex->addTask(task.id, task.tag);
         }
-
-        updateTagFilter();
-        filterTasksByTag(tagFilterCombo->currentText());
+        taskModel->appendTasks(batch);
+        loadedCount += batch.size();
+
+        // Следующая порция читается, только когда эта разобрана:
+        // каждая порция приходит в своей итерации цикла событий
+        if (!last)
+            db->releaseTaskBatch(requestId);
+
+        if (last)
+            finishLoading();
+        else
+            updateLoadingLabel();
     }
 };
 
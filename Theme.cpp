@@ -0,0 +1,160 @@
+#include "Theme.h"
+
+#include <QApplication>
+#include <QPalette>
+#include <algorithm>
+
+// Шаблон таблицы стилей; @Имя заменяется цветом роли
+static const char *const StyleTemplate = R"(
+    QWidget {
+        background-color: @Window;
+        color: @Text;
+        font-family: 'Segoe UI', sans-serif;
+    }
+    QPushButton {
+        background-color: @Accent;
+        color: white;
+        border-radius: 8px;
+        padding: 10px;
+        font-size: 16px;
+    }
+    QPushButton:hover {
+        background-color: @AccentHover;
+    }
+    QWidget#SidePanel {
+        background-color: @Panel;
+    }
+    QLabel {
+        font-size: 20px;
+        color: @Text;
+    }
+    QLabel[role="pageTitle"] {
+        font-size: 24px;
+        font-weight: bold;
+    }
+    QLabel[role="sectionTitle"] {
+        font-size: 16px;
+    }
+    QLabel[role="status"] {
+        font-size: 13px;
+        color: @MutedText;
+    }
+    QLineEdit {
+        background-color: @Panel;
+        color: @Text;
+        font-size: 16px;
+        padding: 8px 12px;
+        border: 2px solid @CardSelected;
+        border-radius: 8px;
+    }
+    QLineEdit:focus {
+        border-color: @Accent;
+        background-color: @InputFocus;
+    }
+    QLineEdit:hover {
+        border-color: @Border;
+    }
+    QLineEdit[role="inlineEditor"] {
+        padding: 6px 8px;
+        border: 1px solid @Border;
+        border-radius: 6px;
+    }
+    QTextEdit, QTextBrowser {
+        background-color: @Panel;
+        color: @Text;
+        font-size: 16px;
+        border: 1px solid @Border;
+        border-radius: 8px;
+        padding: 8px;
+    }
+    QComboBox {
+        font-size: 14px;
+        padding: 4px 8px;
+        background-color: @Panel;
+        color: @Text;
+        border: 1px solid @Border;
+        border-radius: 6px;
+    }
+    QComboBox:hover {
+        border-color: @Accent;
+    }
+    QListWidget {
+        background-color: @Panel;
+        color: @Text;
+        font-size: 15px;
+    }
+    QListWidget::item {
+        padding: 6px;
+    }
+)";
+
+static const char *const RoleNames[] = {
+    "Window", "Panel", "Input", "InputFocus", "Card", "CardSelected",
+    "Border", "Accent", "AccentHover", "Danger", "Text", "MutedText"
+};
+static_assert(sizeof(RoleNames) / sizeof(RoleNames[0]) == Theme::ColorRoleCount, "role names out of sync");
+
+Theme *Theme::instance()
+{
+    static Theme *theme = new Theme(qApp);
+    return theme;
+}
+
+Theme::Theme(QObject *parent)
+    : QObject(parent)
+{
+    // Порядок цветов совпадает с ColorRole
+    m_themes.insert("dark", {
+        QColor("#121212"), QColor("#1e1e1e"), QColor("#1e1e1e"), QColor("#252526"),
+        QColor("#2e2e2e"), QColor("#3a3a3a"), QColor("#555555"), QColor("#2d89ef"),
+        QColor("#1e5cb3"), QColor("#d9534f"), QColor("#ffffff"), QColor("#aaaaaa")
+    });
+    m_themes.insert("light", {
+        QColor("#f3f3f3"), QColor("#ffffff"), QColor("#ffffff"), QColor("#eef5fd"),
+        QColor("#e6e6e6"), QColor("#d0d0d0"), QColor("#b0b0b0"), QColor("#2d89ef"),
+        QColor("#1e5cb3"), QColor("#d9534f"), QColor("#1b1b1b"), QColor("#6b6b6b")
+    });
+    m_current = "dark";
+    m_colors = m_themes.value(m_current);
+}
+
+QString Theme::styleSheet() const
+{
+    QString sheet = QString::fromUtf8(StyleTemplate);
+    // Длинные имена раньше коротких, чтобы @AccentHover не превратился в цвет @Accent + "Hover"
+    QVector<int> roles;
+    for (int role = 0; role < ColorRoleCount; ++role)
+        roles.append(role);
+    std::sort(roles.begin(), roles.end(), [](int a, int b) {
+        return qstrlen(RoleNames[a]) > qstrlen(RoleNames[b]);
+    });
+    for (int role : std::as_const(roles))
+        sheet.replace('@' + QString::fromLatin1(RoleNames[role]), m_colors.at(role).name());
+    return sheet;
+}
+
+void Theme::apply(const QString &name)
+{
+    if (!m_themes.contains(name))
+        return;
+    m_current = name;
+    m_colors = m_themes.value(name);
+
+    // Палитра нужна делегатам и стилю для того, что не описано таблицей стилей
+    QPalette palette = qApp->palette();
+    palette.setColor(QPalette::Window, color(Window));
+    palette.setColor(QPalette::Base, color(Panel));
+    palette.setColor(QPalette::Text, color(Text));
+    palette.setColor(QPalette::WindowText, color(Text));
+    palette.setColor(QPalette::Highlight, color(Accent));
+    qApp->setPalette(palette);
+
+    // Одна таблица стилей на всё приложение: разбор и перерисовка один раз
+    qApp->setStyleSheet(styleSheet());
+    emit changed();
+}
+
+void Theme::toggle()
+{
+    apply(m_current == "dark" ? "light" : "dark");
+}
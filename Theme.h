@@ -0,0 +1,54 @@
+#ifndef THEME_H
+#define THEME_H
+
+#include <QObject>
+#include <QColor>
+#include <QHash>
+#include <QVector>
+#include <QStringList>
+
+// Единая тема приложения: одна таблица стилей на QApplication, виджеты
+// выбирают оформление свойством role (setProperty("role", ...)), делегаты
+// берут цвета отсюда. Смена темы - один вызов apply().
+class Theme : public QObject
+{
+    Q_OBJECT
+public:
+    enum ColorRole {
+        Window,
+        Panel,
+        Input,
+        InputFocus,
+        Card,
+        CardSelected,
+        Border,
+        Accent,
+        AccentHover,
+        Danger,
+        Text,
+        MutedText,
+        ColorRoleCount
+    };
+
+    static Theme *instance();
+
+    QStringList themes() const { return m_themes.keys(); }
+    QString current() const { return m_current; }
+    QColor color(ColorRole role) const { return m_colors.at(role); }
+
+    void apply(const QString &name);
+    void toggle();
+
+signals:
+    void changed();
+
+private:
+    explicit Theme(QObject *parent = nullptr);
+    QString styleSheet() const;
+
+    QHash<QString, QVector<QColor>> m_themes;
+    QVector<QColor> m_colors;
+    QString m_current;
+};
+
+#endif // THEME_H
@@ -0,0 +1,166 @@
+#include "Trace.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QThread>
+#include <QVector>
+#include <QAtomicInt>
+#include <QDebug>
+
+#include <algorithm>
+
+bool Trace::s_enabled = false;
+
+namespace {
+
+struct TraceEvent {
+    const char *category;
+    const char *name;
+    qint64 startNs;
+    qint64 durationNs;
+    int threadId;
+    QString detail;
+};
+
+struct ThreadBuffer;
+
+struct TraceState {
+    QString path;
+    QElapsedTimer clock;
+    QMutex mutex;
+    QVector<TraceEvent> events;                 // события завершившихся потоков
+    QVector<ThreadBuffer *> buffers;            // буферы живых потоков
+    QVector<QPair<int, QString>> threadNames;
+    QAtomicInt nextThreadId;
+};
+
+// Состояние не разрушается: потоки глобального пула завершаются уже
+// после статических деструкторов и ещё сбрасывают свои буферы
+TraceState &state()
+{
+    static TraceState *s = new TraceState;
+    return *s;
+}
+
+// Буфер потока; его мьютекс почти всегда свободен и нужен только
+// для выгрузки в write(), пока поток ещё работает
+struct ThreadBuffer {
+    ThreadBuffer()
+    {
+        TraceState &s = state();
+        threadId = s.nextThreadId.fetchAndAddRelaxed(1) + 1;
+        QString name = QThread::currentThread()->objectName();
+        if (name.isEmpty()) {
+            name = (QCoreApplication::instance() && QThread::currentThread() == QCoreApplication::instance()->thread())
+                       ? QString("main")
+                       : QString("worker %1").arg(threadId);
+        }
+        QMutexLocker locker(&s.mutex);
+        s.threadNames.append({threadId, name});
+        s.buffers.append(this);
+    }
+    ~ThreadBuffer()
+    {
+        TraceState &s = state();
+        QMutexLocker locker(&s.mutex);
+        s.buffers.removeOne(this);
+        s.events.append(events);
+    }
+
+    int threadId;
+    QMutex mutex;
+    QVector<TraceEvent> events;
+};
+
+ThreadBuffer &threadBuffer()
+{
+    thread_local ThreadBuffer buffer;
+    return buffer;
+}
+
+void writeAtExit()
+{
+    Trace::write();
+}
+
+} // namespace
+
+void Trace::init()
+{
+    const QString path = qEnvironmentVariable("KURSTODO_TRACE");
+    if (path.isEmpty())
+        return;
+
+    TraceState &s = state();
+    s.path = path;
+    s.clock.start();
+    s_enabled = true;
+    qAddPostRoutine(writeAtExit);
+}
+
+qint64 Trace::now()
+{
+    return state().clock.nsecsElapsed();
+}
+
+void Trace::record(const char *category, const char *name, qint64 startNs, qint64 endNs, const QString &detail)
+{
+    ThreadBuffer &buffer = threadBuffer();
+    QMutexLocker locker(&buffer.mutex);
+    buffer.events.append({category, name, startNs, endNs - startNs, buffer.threadId, detail});
+}
+
+bool Trace::write()
+{
+    if (!s_enabled)
+        return false;
+    TraceState &s = state();
+    QMutexLocker locker(&s.mutex);
+    for (ThreadBuffer *buffer : std::as_const(s.buffers)) {
+        QMutexLocker bufferLocker(&buffer->mutex);
+        s.events.append(buffer->events);
+        buffer->events.clear();
+    }
+    std::sort(s.events.begin(), s.events.end(), [](const TraceEvent &a, const TraceEvent &b) {
+        return a.startNs < b.startNs;
+    });
+
+    QSaveFile file(s.path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to write trace:" << file.errorString();
+        return false;
+    }
+
+    // Объекты пишутся по одному, без построения общего QJsonArray
+    file.write("{\"traceEvents\":[\n");
+    bool first = true;
+    auto writeEvent = [&](const QJsonObject &event) {
+        if (!first)
+            file.write(",\n");
+        first = false;
+        file.write(QJsonDocument(event).toJson(QJsonDocument::Compact));
+    };
+    for (const auto &thread : std::as_const(s.threadNames)) {
+        writeEvent({{"name", "thread_name"}, {"ph", "M"}, {"pid", 1}, {"tid", thread.first},
+                    {"args", QJsonObject{{"name", thread.second}}}});
+    }
+    for (const TraceEvent &event : std::as_const(s.events)) {
+        QJsonObject object{{"name", event.name}, {"cat", event.category}, {"ph", "X"},
+                           {"ts", event.startNs / 1000.0}, {"dur", event.durationNs / 1000.0},
+                           {"pid", 1}, {"tid", event.threadId}};
+        if (!event.detail.isEmpty())
+            object.insert("args", QJsonObject{{"detail", event.detail}});
+        writeEvent(object);
+    }
+    file.write("\n]}\n");
+
+    if (!file.commit()) {
+        qWarning() << "Failed to commit trace:" << file.errorString();
+        return false;
+    }
+    return true;
+}
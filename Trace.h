@@ -0,0 +1,63 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QString>
+#include <QtGlobal>
+
+// Трассировка горячих путей в формате Chrome trace-event (chrome://tracing, Perfetto).
+// Включается переменной окружения KURSTODO_TRACE=путь/к/trace.json; без неё
+// отрезок стоит одной проверки флага. События копятся в буфере потока
+// и записываются в файл при завершении приложения.
+class Trace
+{
+public:
+    // Читает KURSTODO_TRACE; вызывается после создания QCoreApplication
+    static void init();
+    static bool isEnabled() { return s_enabled; }
+
+    static qint64 now();
+    static void record(const char *category, const char *name, qint64 startNs, qint64 endNs,
+                       const QString &detail);
+    // Сбрасывает все буферы в файл; вызывается автоматически при выходе
+    static bool write();
+
+private:
+    static bool s_enabled;
+};
+
+// Отрезок времени от конструктора до деструктора
+class TraceSpan
+{
+public:
+    TraceSpan(const char *category, const char *name)
+        : m_category(category), m_name(name), m_start(Trace::isEnabled() ? Trace::now() : -1) {}
+    ~TraceSpan()
+    {
+        if (m_start >= 0)
+            Trace::record(m_category, m_name, m_start, Trace::now(), m_detail);
+    }
+
+    void setDetail(const QString &detail) { m_detail = detail; }
+
+private:
+    Q_DISABLE_COPY(TraceSpan)
+
+    const char *m_category;
+    const char *m_name;
+    qint64 m_start;
+    QString m_detail;
+};
+
+#define KURSTODO_TRACE_CONCAT_(a, b) a##b
+#define KURSTODO_TRACE_CONCAT(a, b) KURSTODO_TRACE_CONCAT_(a, b)
+
+// TRACE_SCOPE("sql", "addTask"); - отрезок до конца блока
+#define TRACE_SCOPE(category, name) \
+    TraceSpan KURSTODO_TRACE_CONCAT(traceSpan_, __LINE__)(category, name)
+
+// То же с подробностью; выражение detail вычисляется только при включённой трассировке
+#define TRACE_SCOPE_DETAIL(category, name, detail) \
+    TRACE_SCOPE(category, name); \
+    if (Trace::isEnabled()) KURSTODO_TRACE_CONCAT(traceSpan_, __LINE__).setDetail(detail)
+
+#endif // TRACE_H
@@ -0,0 +1,14 @@
+TEMPLATE = app
+TARGET = KursToDo
+
+include(../gui.pri)
+
+SOURCES += \
+    ../main.cpp
+
+FORMS +=
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
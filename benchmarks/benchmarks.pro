@@ -0,0 +1,16 @@
+# Микробенчмарки горячих путей хранилища и списка задач.
+# Машиночитаемые результаты для сравнения версий:
+#   ./benchmarks -o results.csv,csv
+#   ./benchmarks -o results.xml,xml
+# Отдельный тест и размер: ./benchmarks filterByTag:100k
+TEMPLATE = app
+TARGET = benchmarks
+
+QT += testlib
+CONFIG += console
+CONFIG -= app_bundle
+
+include(../gui.pri)
+
+SOURCES += \
+    tst_benchmarks.cpp
@@ -0,0 +1,384 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QBuffer>
+#include <QImage>
+#include <algorithm>
+#include "DatabaseManager.h"
+#include "DeadlineScheduler.h"
+#include "TaskCursor.h"
+#include "TaskJournal.h"
+#include "TaskSnapshot.h"
+#include "TaskModel.h"
+#include "TagIndex.h"
+#include "TaskFilterProxyModel.h"
+
+// Замеры на 1k/10k/100k задач. Каждый тест работает со своей базой
+// во временном каталоге, подготовка данных в замер не входит, кроме
+// тестов, помеченных QBENCHMARK_ONCE (операция необратима).
+class Benchmarks : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void insertBatch_data() { sizes(); }
+    void insertBatch();
+    void insertSingle_data() { sizes(); }
+    void insertSingle();
+    void updateBatch_data() { sizes(); }
+    void updateBatch();
+    void deleteBatch_data() { sizes(); }
+    void deleteBatch();
+    void getAllTasks_data() { sizes(); }
+    void getAllTasks();
+    void cursorBatches_data() { sizes(); }
+    void cursorBatches();
+    void searchPrefix_data();
+    void searchPrefix();
+    void journalRoundTrip_data() { sizes(); }
+    void journalRoundTrip();
+    void snapshotLoad_data() { sizes(); }
+    void snapshotLoad();
+    void snapshotRewrite_data() { sizes(); }
+    void snapshotRewrite();
+    void appendToModel_data() { sizes(); }
+    void appendToModel();
+    void filterByTag_data() { sizes(); }
+    void filterByTag();
+    void addNoteWithImage();
+    void noteHistory();
+    void recurringMonth();
+    void deadlineUpdates_data() { sizes(); }
+    void deadlineUpdates();
+
+private:
+    static void sizes();
+    static QVector<Task> makeTasks(int count);
+    void fill(int count);
+
+    QTemporaryDir *dir = nullptr;
+    DatabaseManager *db = nullptr;
+};
+
+void Benchmarks::sizes()
+{
+    QTest::addColumn<int>("count");
+    QTest::newRow("1k") << 1000;
+    QTest::newRow("10k") << 10000;
+    QTest::newRow("100k") << 100000;
+}
+
+QVector<Task> Benchmarks::makeTasks(int count)
+{
+    QVector<Task> tasks;
+    tasks.reserve(count);
+    const QDate start(2024, 1, 1);
+    for (int i = 0; i < count; ++i) {
+        Task task;
+        task.id = i + 1;
+        task.text = QString("Задача номер %1").arg(i);
+        if (i % 4 != 0)
+            task.date = start.addDays(i % 730);
+        task.tag = QString("tag%1").arg(i % 16);
+        task.completed = i % 3 == 0;
+        tasks.append(task);
+    }
+    return tasks;
+}
+
+void Benchmarks::init()
+{
+    dir = new QTemporaryDir;
+    QVERIFY(dir->isValid());
+    db = new DatabaseManager;
+    QVERIFY(db->openDatabase(dir->filePath("bench.db"), DatabasePragmas(), "bench"));
+    QVERIFY(db->createTables());
+}
+
+void Benchmarks::cleanup()
+{
+    delete db;
+    db = nullptr;
+    delete dir;
+    dir = nullptr;
+}
+
+void Benchmarks::fill(int count)
+{
+    QVector<Task> tasks = makeTasks(count);
+    QVERIFY(db->addTasks(tasks));
+}
+
+void Benchmarks::insertBatch()
+{
+    QFETCH(int, count);
+    const QVector<Task> tasks = makeTasks(count);
+    QBENCHMARK {
+        QVector<Task> batch = tasks;
+        db->addTasks(batch);
+    }
+}
+
+void Benchmarks::insertSingle()
+{
+    QFETCH(int, count);
+    const QVector<Task> tasks = makeTasks(count);
+    QBENCHMARK_ONCE {
+        for (const Task &task : tasks)
+            db->addTask(task.text, task.date, task.tag, task.completed);
+    }
+}
+
+void Benchmarks::updateBatch()
+{
+    QFETCH(int, count);
+    fill(count);
+    QVector<Task> tasks = makeTasks(count);
+    QBENCHMARK {
+        for (Task &task : tasks)
+            task.completed = !task.completed;
+        db->updateTasks(tasks);
+    }
+}
+
+void Benchmarks::deleteBatch()
+{
+    QFETCH(int, count);
+    fill(count);
+    QVector<qint64> ids;
+    ids.reserve(count);
+    for (int i = 1; i <= count; ++i)
+        ids.append(i);
+    QBENCHMARK_ONCE {
+        db->deleteTasks(ids);
+    }
+}
+
+void Benchmarks::getAllTasks()
+{
+    QFETCH(int, count);
+    fill(count);
+    QBENCHMARK {
+        QCOMPARE(db->getAllTasks().size(), count);
+    }
+}
+
+void Benchmarks::cursorBatches()
+{
+    QFETCH(int, count);
+    fill(count);
+    QBENCHMARK {
+        TaskCursor cursor(db->database(), 500);
+        int read = 0;
+        while (!cursor.atEnd())
+            read += cursor.fetchNext().size();
+        QCOMPARE(read, count);
+    }
+}
+
+void Benchmarks::searchPrefix_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::newRow("1 letter") << QString("з");
+    QTest::newRow("2 letters") << QString("за");
+    QTest::newRow("3 letters") << QString("зад");
+    QTest::newRow("word + prefix") << QString("задача но");
+}
+
+// Поиск по мере ввода на 100k задач, цель - меньше 10 мс на запрос
+void Benchmarks::searchPrefix()
+{
+    QFETCH(QString, text);
+    fill(100000);
+    QBENCHMARK {
+        QVERIFY(!db->search(text).isEmpty());
+    }
+}
+
+void Benchmarks::journalRoundTrip()
+{
+    QFETCH(int, count);
+    const QVector<Task> tasks = makeTasks(count);
+    const QString path = dir->filePath("tasks.json");
+    QBENCHMARK {
+        TaskJournal journal(path);
+        journal.load();
+        journal.compact(tasks);
+        journal.waitForCompaction();
+        QCOMPARE(journal.load().size(), count);
+    }
+}
+
+// Открытие снимка, индекс тегов и заполнение модели; читаются тексты только первого экрана
+void Benchmarks::snapshotLoad()
+{
+    QFETCH(int, count);
+    const QString path = dir->filePath("tasks.snapshot");
+    QVERIFY(TaskSnapshot::write(path, makeTasks(count), 1));
+    QBENCHMARK {
+        std::shared_ptr<const TaskSnapshot> snapshot = TaskSnapshot::open(path);
+        QVERIFY(snapshot);
+        TagIndex index;
+        index.addBatch(TagIndex::batchFromSnapshot(*snapshot));
+        QCOMPARE(int(index.allTasks().cardinality()), count);
+        TaskModel model;
+        model.appendSnapshot(snapshot);
+        QCOMPARE(model.rowCount(), count);
+        for (int row = 0; row < 50; ++row)
+            QVERIFY(!model.taskAt(row).text.isEmpty());
+    }
+}
+
+// Перезапись снимка после правки одной задачи: остальные записи копируются из файла
+void Benchmarks::snapshotRewrite()
+{
+    QFETCH(int, count);
+    const QString path = dir->filePath("tasks.snapshot");
+    const QString copyPath = dir->filePath("tasks.snapshot.copy");
+    QVERIFY(TaskSnapshot::write(path, makeTasks(count), 1));
+    std::shared_ptr<const TaskSnapshot> snapshot = TaskSnapshot::open(path);
+    QVERIFY(snapshot);
+    TaskModel model;
+    model.appendSnapshot(snapshot);
+    QVERIFY(model.setData(model.index(0), "Изменённая задача"));
+
+    QBENCHMARK {
+        QVERIFY(TaskSnapshot::write(copyPath, model.rows(), model.ownedTasks(), model.snapshot(), 2));
+    }
+    std::shared_ptr<const TaskSnapshot> copy = TaskSnapshot::open(copyPath);
+    QVERIFY(copy);
+    QCOMPARE(copy->count(), count);
+    QCOMPARE(copy->text(0), QString("Изменённая задача"));
+    QCOMPARE(copy->text(count - 1), snapshot->text(count - 1));
+    QCOMPARE(copy->tag(count - 1), snapshot->tag(count - 1));
+}
+
+void Benchmarks::appendToModel()
+{
+    QFETCH(int, count);
+    const QVector<Task> tasks = makeTasks(count);
+    QBENCHMARK {
+        TaskModel model;
+        TagIndex index;
+        TaskFilterProxyModel proxy(&index);
+        proxy.setSourceModel(&model);
+        proxy.setTagExpression("tag1 | tag2");
+        for (const Task &task : tasks) {
+            index.addTask(task.id, task.tag);
+            model.appendTask(task);
+        }
+    }
+}
+
+void Benchmarks::filterByTag()
+{
+    QFETCH(int, count);
+    const QVector<Task> tasks = makeTasks(count);
+    TaskModel model;
+    TagIndex index;
+    TaskFilterProxyModel proxy(&index);
+    proxy.setSourceModel(&model);
+    for (const Task &task : tasks)
+        index.addTask(task.id, task.tag);
+    model.appendTasks(tasks);
+
+    QBENCHMARK {
+        proxy.setTagExpression("tag3");
+        proxy.setTagExpression("(tag1 | tag2) & !tag5");
+    }
+    const int expected = std::count_if(tasks.cbegin(), tasks.cend(), [](const Task &task) {
+        return task.tag == "tag1" || task.tag == "tag2";
+    });
+    QCOMPARE(proxy.rowCount(), expected);
+}
+
+void Benchmarks::addNoteWithImage()
+{
+    QImage image(1600, 1200, QImage::Format_RGB32);
+    image.fill(QColor("#2d89ef"));
+    QByteArray png;
+    QBuffer buffer(&png);
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, "PNG");
+
+    QBENCHMARK {
+        const qint64 blobId = db->storeBlob(png);
+        const QString html = QString("<p>Фото</p><img src=\"blob:%1\" width=\"200\" />").arg(blobId);
+        db->addNote(html, "Фото");
+    }
+}
+
+// Правка длинной заметки с записью ревизии; восстановление самой дальней от ключевого кадра
+void Benchmarks::noteHistory()
+{
+    QString html;
+    for (int i = 0; i < 400; ++i)
+        html += QString("<p>Абзац %1: текст заметки, который почти не меняется.</p>").arg(i);
+    const qint64 id = db->addNote(html, QString());
+    QVERIFY(id > 0);
+
+    int edit = 0;
+    QBENCHMARK {
+        html.insert(html.size() / 2, QString("<p>Правка %1</p>").arg(++edit));
+        QVERIFY(db->updateNote(id, html, QString()));
+    }
+
+    const QVector<NoteRevision> revisions = db->noteRevisions(id);
+    QVERIFY(!revisions.isEmpty());
+    QCOMPARE(db->noteRevisionText(id, revisions.first().revision), html);
+}
+
+void Benchmarks::recurringMonth()
+{
+    static const char *const rules[] = {
+        "FREQ=DAILY", "FREQ=WEEKLY;BYDAY=MO,WE,FR", "FREQ=WEEKLY;INTERVAL=2",
+        "FREQ=MONTHLY;BYMONTHDAY=-1", "FREQ=YEARLY"
+    };
+    QVector<Task> tasks = makeTasks(1000);
+    for (int i = 0; i < tasks.size(); ++i) {
+        tasks[i].date = QDate(2024, 1, 1).addDays(i % 365);
+        tasks[i].completed = false;
+        tasks[i].recurrence = rules[i % 5];
+    }
+    QVERIFY(db->addTasks(tasks));
+
+    // Месяц через годы после начала серий; отметка сбрасывает кэш повторений
+    const QDate month(2030, 6, 1);
+    bool done = false;
+    QBENCHMARK {
+        done = !done;
+        QVERIFY(db->setOccurrenceState(tasks.first().id, month,
+                                       done ? DatabaseManager::OccurrenceDone : DatabaseManager::OccurrenceOpen));
+        QVERIFY(!db->countByDay(month).isEmpty());
+    }
+}
+
+void Benchmarks::deadlineUpdates()
+{
+    QFETCH(int, count);
+    QVector<Task> tasks = makeTasks(count);
+    const QDate today = QDate::currentDate();
+    for (Task &task : tasks) {
+        if (task.date.isValid())
+            task.date = today.addDays(1 + task.id % 730);
+    }
+
+    DeadlineScheduler scheduler;
+    scheduler.setTasks(tasks);
+    QVERIFY(scheduler.count() > 0);
+
+    // Перенос срока, отметка и возврат задачи - по O(log n) каждое
+    int step = 0;
+    QBENCHMARK {
+        Task &task = tasks[(step * 7919) % tasks.size()];
+        task.date = today.addDays(1 + (step++ % 365));
+        task.completed = !task.completed;
+        scheduler.updateTask(task);
+    }
+    QVERIFY(scheduler.nextDeadline().isValid());
+}
+
+QTEST_MAIN(Benchmarks)
+#include "tst_benchmarks.moc"
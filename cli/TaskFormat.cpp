@@ -0,0 +1,439 @@
+#include "TaskFormat.h"
+#include "TaskJournal.h"
+#include "Trace.h"
+
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+qsizetype indexOf(QByteArrayView data, const char *needle, qsizetype from)
+{
+    const qsizetype length = qsizetype(std::strlen(needle));
+    if (from < 0 || from >= data.size())
+        return -1;
+    const char *begin = data.data() + from;
+    const char *end = data.data() + data.size();
+    const char *found = std::search(begin, end, needle, needle + length);
+    return found == end ? -1 : found - data.data();
+}
+
+// Разбор CSV по RFC 4180: поля в кавычках могут содержать запятые и переводы строк
+template <typename RecordFn>
+void forEachCsvRecord(QByteArrayView data, RecordFn onRecord)
+{
+    QVector<QByteArray> fields;
+    QByteArray field;
+    bool quoted = false;
+    bool pending = false;
+    for (qsizetype i = 0; i < data.size(); ++i) {
+        const char c = data[i];
+        if (quoted) {
+            if (c == '"') {
+                if (i + 1 < data.size() && data[i + 1] == '"') {
+                    field.append('"');
+                    ++i;
+                } else {
+                    quoted = false;
+                }
+            } else {
+                field.append(c);
+            }
+            continue;
+        }
+        switch (c) {
+        case '"':
+            quoted = true;
+            pending = true;
+            break;
+        case ',':
+            fields.append(field);
+            field.clear();
+            pending = true;
+            break;
+        case '\r':
+            break;
+        case '\n':
+            fields.append(field);
+            field.clear();
+            onRecord(fields);
+            fields.clear();
+            pending = false;
+            break;
+        default:
+            field.append(c);
+            pending = true;
+        }
+    }
+    if (pending) {
+        fields.append(field);
+        onRecord(fields);
+    }
+}
+
+QString icsUnescape(QByteArrayView value)
+{
+    QByteArray result;
+    result.reserve(value.size());
+    for (qsizetype i = 0; i < value.size(); ++i) {
+        if (value[i] == '\\' && i + 1 < value.size()) {
+            const char next = value[++i];
+            result.append(next == 'n' || next == 'N' ? '\n' : next);
+        } else {
+            result.append(value[i]);
+        }
+    }
+    return QString::fromUtf8(result);
+}
+
+// Строка iCalendar длиннее 75 байт переносится с пробелом в начале продолжения,
+// не разрывая символы UTF-8
+void writeIcsLine(QIODevice &out, const QByteArray &line)
+{
+    qsizetype start = 0;
+    qsizetype limit = 75;
+    while (line.size() - start > limit) {
+        qsizetype cut = start + limit;
+        while (cut > start && (uchar(line[cut]) & 0xC0) == 0x80)
+            --cut;
+        out.write(line.constData() + start, cut - start);
+        out.write("\r\n ");
+        start = cut;
+        limit = 74;
+    }
+    out.write(line.constData() + start, line.size() - start);
+    out.write("\r\n");
+}
+
+} // namespace
+
+TaskFormat::Kind TaskFormat::fromName(const QString &nameOrPath)
+{
+    QString name = nameOrPath.toLower();
+    if (name.contains('.'))
+        name = QFileInfo(name).suffix();
+    if (name == "json")
+        return Json;
+    if (name == "csv")
+        return Csv;
+    if (name == "ics" || name == "ical")
+        return Ics;
+    return Unknown;
+}
+
+QDate TaskFormat::parseDate(QByteArrayView value)
+{
+    const QString text = QString::fromLatin1(value).trimmed();
+    if (text.isEmpty())
+        return QDate();
+    QDate date = QDate::fromString(text, "dd.MM.yyyy");
+    if (!date.isValid())
+        date = QDate::fromString(text.left(10), Qt::ISODate);
+    if (!date.isValid())
+        date = QDate::fromString(text.left(8), "yyyyMMdd");
+    return date;
+}
+
+QVector<QByteArrayView> TaskFormat::splitChunks(QByteArrayView data, Kind kind, qsizetype chunkSize,
+                                                CsvColumns *columns)
+{
+    QVector<QByteArrayView> chunks;
+    qsizetype start = 0;
+
+    if (kind == Csv) {
+        // Заголовок - первая строка, если в ней есть столбец text
+        const qsizetype headerEnd = indexOf(data, "\n", 0);
+        const QByteArrayView header = data.first(headerEnd < 0 ? data.size() : headerEnd);
+        bool hasHeader = false;
+        forEachCsvRecord(header, [&](const QVector<QByteArray> &fields) {
+            CsvColumns found;
+            found.text = found.date = found.tag = found.completed = -1;
+            for (int i = 0; i < fields.size(); ++i) {
+                const QByteArray name = fields.at(i).trimmed().toLower();
+                if (name == "text") found.text = i;
+                else if (name == "date") found.date = i;
+                else if (name == "tag") found.tag = i;
+                else if (name == "completed") found.completed = i;
+            }
+            hasHeader = found.text >= 0;
+            if (hasHeader && columns)
+                *columns = found;
+        });
+        if (hasHeader)
+            start = headerEnd < 0 ? data.size() : headerEnd + 1;
+
+        // Граница куска - перевод строки вне кавычек
+        bool quoted = false;
+        qsizetype chunkStart = start;
+        for (qsizetype i = start; i < data.size(); ++i) {
+            const char c = data[i];
+            if (c == '"')
+                quoted = !quoted;
+            else if (c == '\n' && !quoted && i + 1 - chunkStart >= chunkSize) {
+                chunks.append(data.sliced(chunkStart, i + 1 - chunkStart));
+                chunkStart = i + 1;
+            }
+        }
+        if (chunkStart < data.size())
+            chunks.append(data.sliced(chunkStart));
+        return chunks;
+    }
+
+    if (kind == Ics) {
+        // Граница куска - конец строки END:VTODO / END:VEVENT
+        while (start < data.size()) {
+            qsizetype end = indexOf(data, "\nEND:V", start + chunkSize);
+            if (end >= 0)
+                end = indexOf(data, "\n", end + 1);
+            if (end < 0) {
+                chunks.append(data.sliced(start));
+                break;
+            }
+            chunks.append(data.sliced(start, end + 1 - start));
+            start = end + 1;
+        }
+        return chunks;
+    }
+
+    chunks.append(data);
+    return chunks;
+}
+
+QVector<Task> TaskFormat::parseCsv(QByteArrayView chunk, const CsvColumns &columns)
+{
+    TRACE_SCOPE_DETAIL("parse", "parseCsv", QString::number(chunk.size()));
+    QVector<Task> tasks;
+    auto field = [](const QVector<QByteArray> &fields, int index) {
+        return index >= 0 && index < fields.size() ? fields.at(index) : QByteArray();
+    };
+    forEachCsvRecord(chunk, [&](const QVector<QByteArray> &fields) {
+        Task task;
+        task.text = QString::fromUtf8(field(fields, columns.text)).trimmed();
+        if (task.text.isEmpty())
+            return;
+        task.date = parseDate(field(fields, columns.date));
+        task.tag = QString::fromUtf8(field(fields, columns.tag)).trimmed();
+        const QByteArray completed = field(fields, columns.completed).trimmed().toLower();
+        task.completed = completed == "1" || completed == "true" || completed == "yes";
+        tasks.append(task);
+    });
+    return tasks;
+}
+
+QVector<Task> TaskFormat::parseIcs(QByteArrayView chunk)
+{
+    TRACE_SCOPE_DETAIL("parse", "parseIcs", QString::number(chunk.size()));
+    QVector<Task> tasks;
+    Task task;
+    bool inItem = false;
+    QDate start;
+    QByteArray line;
+
+    auto handleLine = [&](const QByteArray &contentLine) {
+        const qsizetype colon = contentLine.indexOf(':');
+        if (colon < 0)
+            return;
+        QByteArray name = contentLine.left(colon);
+        const qsizetype params = name.indexOf(';');
+        if (params >= 0)
+            name.truncate(params);
+        name = name.toUpper();
+        const QByteArrayView value = QByteArrayView(contentLine).sliced(colon + 1);
+
+        if (name == "BEGIN" && (value == "VTODO" || value == "VEVENT")) {
+            task = Task();
+            start = QDate();
+            inItem = true;
+        } else if (name == "END" && inItem && (value == "VTODO" || value == "VEVENT")) {
+            inItem = false;
+            // Повторения отсчитываются от DTSTART
+            if (!task.date.isValid() || (task.isRecurring() && start.isValid()))
+                task.date = start;
+            if (!task.date.isValid())
+                task.recurrence.clear();
+            if (!task.text.isEmpty())
+                tasks.append(task);
+        } else if (!inItem) {
+            return;
+        } else if (name == "SUMMARY") {
+            task.text = icsUnescape(value).trimmed();
+        } else if (name == "DUE") {
+            task.date = parseDate(value);
+        } else if (name == "DTSTART") {
+            start = parseDate(value);
+        } else if (name == "CATEGORIES") {
+            task.tag = icsUnescape(value).section(',', 0, 0).trimmed();
+        } else if (name == "STATUS") {
+            task.completed = value == "COMPLETED";
+        } else if (name == "COMPLETED") {
+            task.completed = true;
+        } else if (name == "RRULE") {
+            const Recurrence rule = Recurrence::parse(QString::fromLatin1(value));
+            if (rule.isValid())
+                task.recurrence = rule.toString();
+        }
+    };
+
+    // Строки, начинающиеся с пробела или табуляции, продолжают предыдущую
+    qsizetype pos = 0;
+    while (pos < chunk.size()) {
+        qsizetype end = indexOf(chunk, "\n", pos);
+        if (end < 0)
+            end = chunk.size();
+        QByteArrayView raw = chunk.sliced(pos, end - pos);
+        if (raw.endsWith('\r'))
+            raw.chop(1);
+        if (!raw.isEmpty() && (raw[0] == ' ' || raw[0] == '\t')) {
+            line.append(raw.sliced(1));
+        } else {
+            if (!line.isEmpty())
+                handleLine(line);
+            line = raw.toByteArray();
+        }
+        pos = end + 1;
+    }
+    if (!line.isEmpty())
+        handleLine(line);
+    return tasks;
+}
+
+QVector<Task> TaskFormat::parseJson(const QByteArray &data, bool *ok)
+{
+    TRACE_SCOPE_DETAIL("parse", "parseJson", QString::number(data.size()));
+    QJsonParseError error;
+    const QJsonDocument doc = QJsonDocument::fromJson(data, &error);
+    if (ok)
+        *ok = doc.isArray();
+    if (!doc.isArray())
+        return {};
+
+    // Документ уже разобран; перевод объектов в задачи идёт диапазонами в пуле
+    const QJsonArray array = doc.array();
+    constexpr int RangeSize = 16 * 1024;
+    QVector<QPair<int, int>> ranges;
+    for (int from = 0; from < array.size(); from += RangeSize)
+        ranges.append({from, qMin<int>(from + RangeSize, array.size())});
+
+    const QList<QVector<Task>> parts = QtConcurrent::blockingMapped<QList<QVector<Task>>>(
+        ranges, [&array](const QPair<int, int> &range) {
+            QVector<Task> tasks;
+            tasks.reserve(range.second - range.first);
+            for (int i = range.first; i < range.second; ++i) {
+                const QJsonValue value = array.at(i);
+                if (!value.isObject())
+                    continue;
+                Task task = TaskJournal::taskFromJson(value.toObject());
+                if (!task.text.isEmpty())
+                    tasks.append(task);
+            }
+            return tasks;
+        });
+
+    QVector<Task> tasks;
+    tasks.reserve(array.size());
+    for (const QVector<Task> &part : parts)
+        tasks.append(part);
+    return tasks;
+}
+
+QByteArray TaskFormat::csvField(const QString &value)
+{
+    QByteArray bytes = value.toUtf8();
+    if (bytes.contains(',') || bytes.contains('"') || bytes.contains('\n') || bytes.contains('\r')) {
+        bytes.replace("\"", "\"\"");
+        bytes = '"' + bytes + '"';
+    }
+    return bytes;
+}
+
+QByteArray TaskFormat::icsText(const QString &value)
+{
+    QByteArray bytes = value.toUtf8();
+    bytes.replace("\\", "\\\\");
+    bytes.replace(";", "\\;");
+    bytes.replace(",", "\\,");
+    bytes.replace("\n", "\\n");
+    return bytes;
+}
+
+void TaskFormat::begin(QIODevice &out, Kind kind)
+{
+    switch (kind) {
+    case Json:
+        out.write("[");
+        break;
+    case Csv:
+        out.write("text,date,tag,completed\n");
+        break;
+    case Ics:
+        writeIcsLine(out, "BEGIN:VCALENDAR");
+        writeIcsLine(out, "VERSION:2.0");
+        writeIcsLine(out, "PRODID:-//KursToDo//Tasks//RU");
+        break;
+    case Unknown:
+        break;
+    }
+}
+
+void TaskFormat::writeBatch(QIODevice &out, Kind kind, const QVector<Task> &tasks, bool first)
+{
+    QByteArray buffer;
+    buffer.reserve(tasks.size() * 96);
+    for (int i = 0; i < tasks.size(); ++i) {
+        const Task &task = tasks.at(i);
+        switch (kind) {
+        case Json:
+            buffer += (first && i == 0) ? "\n  " : ",\n  ";
+            buffer += QJsonDocument(TaskJournal::taskToJson(task)).toJson(QJsonDocument::Compact);
+            break;
+        case Csv:
+            buffer += csvField(task.text) + ','
+                      + (task.date.isValid() ? task.date.toString("dd.MM.yyyy").toLatin1() : QByteArray()) + ','
+                      + csvField(task.tag) + ','
+                      + (task.completed ? "1" : "0") + '\n';
+            break;
+        case Ics:
+        case Unknown:
+            break;
+        }
+    }
+    if (kind != Ics) {
+        out.write(buffer);
+        return;
+    }
+
+    for (const Task &task : tasks) {
+        writeIcsLine(out, "BEGIN:VTODO");
+        writeIcsLine(out, "UID:kurstodo-" + QByteArray::number(task.id));
+        writeIcsLine(out, "SUMMARY:" + icsText(task.text));
+        if (task.date.isValid())
+            writeIcsLine(out, "DUE;VALUE=DATE:" + task.date.toString("yyyyMMdd").toLatin1());
+        if (task.isRecurring() && task.date.isValid()) {
+            writeIcsLine(out, "DTSTART;VALUE=DATE:" + task.date.toString("yyyyMMdd").toLatin1());
+            writeIcsLine(out, "RRULE:" + task.recurrence.toLatin1());
+        }
+        if (!task.tag.isEmpty())
+            writeIcsLine(out, "CATEGORIES:" + icsText(task.tag));
+        writeIcsLine(out, task.completed ? "STATUS:COMPLETED" : "STATUS:NEEDS-ACTION");
+        writeIcsLine(out, "END:VTODO");
+    }
+}
+
+void TaskFormat::end(QIODevice &out, Kind kind)
+{
+    switch (kind) {
+    case Json:
+        out.write("\n]\n");
+        break;
+    case Ics:
+        writeIcsLine(out, "END:VCALENDAR");
+        break;
+    case Csv:
+    case Unknown:
+        break;
+    }
+}
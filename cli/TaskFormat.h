@@ -0,0 +1,48 @@
+#ifndef TASKFORMAT_H
+#define TASKFORMAT_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QVector>
+#include <QIODevice>
+#include "Task.h"
+
+// Форматы обмена задачами для консольного импорта/экспорта:
+// JSON (схема tasks.json), CSV (text,date,tag,completed) и iCalendar (VTODO).
+class TaskFormat
+{
+public:
+    enum Kind { Unknown, Json, Csv, Ics };
+
+    // По имени формата ("csv") или расширению файла
+    static Kind fromName(const QString &nameOrPath);
+
+    // Номера столбцов CSV, -1 - столбца нет
+    struct CsvColumns {
+        int text = 0;
+        int date = 1;
+        int tag = 2;
+        int completed = 3;
+    };
+
+    // Режет данные на куски примерно по chunkSize байт по границам записей,
+    // куски разбираются независимо. Для CSV заголовок отрезается и разбирается в columns.
+    static QVector<QByteArrayView> splitChunks(QByteArrayView data, Kind kind, qsizetype chunkSize,
+                                               CsvColumns *columns = nullptr);
+    static QVector<Task> parseCsv(QByteArrayView chunk, const CsvColumns &columns);
+    static QVector<Task> parseIcs(QByteArrayView chunk);
+    // Массив tasks.json; объекты в задачи переводятся параллельно
+    static QVector<Task> parseJson(const QByteArray &data, bool *ok = nullptr);
+
+    // Потоковая запись: begin, любое число writeBatch, end
+    static void begin(QIODevice &out, Kind kind);
+    static void writeBatch(QIODevice &out, Kind kind, const QVector<Task> &tasks, bool first);
+    static void end(QIODevice &out, Kind kind);
+
+private:
+    static QDate parseDate(QByteArrayView value);
+    static QByteArray csvField(const QString &value);
+    static QByteArray icsText(const QString &value);
+};
+
+#endif // TASKFORMAT_H
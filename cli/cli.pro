@@ -0,0 +1,16 @@
+# Консольный массовый импорт/экспорт задач; QtWidgets не нужен
+TEMPLATE = app
+TARGET = kurstodo-cli
+
+QT -= gui
+CONFIG += console
+CONFIG -= app_bundle
+
+include(../core.pri)
+
+SOURCES += \
+    TaskFormat.cpp \
+    main.cpp
+
+HEADERS += \
+    TaskFormat.h
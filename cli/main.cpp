@@ -0,0 +1,191 @@
+// main.cpp - консольный импорт/экспорт задач без QtWidgets
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QtConcurrent>
+#include "DatabaseManager.h"
+#include "TaskCursor.h"
+#include "TaskFormat.h"
+#include "Trace.h"
+
+namespace {
+
+QTextStream &out()
+{
+    static QTextStream stream(stdout);
+    return stream;
+}
+
+void report(const QString &action, qint64 rows, qint64 bytes, qint64 totalMs, qint64 parseMs, qint64 writeMs)
+{
+    const double seconds = qMax<qint64>(totalMs, 1) / 1000.0;
+    out() << action << ": " << rows << " задач, " << QString::number(bytes / 1048576.0, 'f', 1) << " МБ за "
+          << QString::number(seconds, 'f', 2) << " с (разбор " << parseMs << " мс, запись " << writeMs << " мс), "
+          << qRound64(rows / seconds) << " задач/с, "
+          << QString::number(bytes / 1048576.0 / seconds, 'f', 1) << " МБ/с" << Qt::endl;
+}
+
+int importTasks(DatabaseManager &db, const QString &path, TaskFormat::Kind kind, int batchSize, qsizetype chunkSize)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Failed to open" << path << ":" << file.errorString();
+        return 1;
+    }
+    // Файл отображается в память, куски разбираются прямо из отображения без копий
+    const qint64 size = file.size();
+    const uchar *mapped = size > 0 ? file.map(0, size) : nullptr;
+    if (size > 0 && !mapped) {
+        qWarning() << "Failed to map" << path << ":" << file.errorString();
+        return 1;
+    }
+    const QByteArrayView data(reinterpret_cast<const char *>(mapped), size);
+
+    QElapsedTimer total;
+    total.start();
+    qint64 parseMs = 0;
+    qint64 writeMs = 0;
+    qint64 rows = 0;
+
+    // Запись большими транзакциями: одна на batchSize задач
+    auto write = [&](QVector<Task> &tasks) {
+        QElapsedTimer timer;
+        timer.start();
+        for (qsizetype from = 0; from < tasks.size(); from += batchSize) {
+            QVector<Task> batch = tasks.mid(from, batchSize);
+            if (!db.addTasks(batch))
+                return false;
+            rows += batch.size();
+        }
+        writeMs += timer.elapsed();
+        return true;
+    };
+
+    if (kind == TaskFormat::Json) {
+        QElapsedTimer timer;
+        timer.start();
+        bool ok = false;
+        QVector<Task> tasks = TaskFormat::parseJson(QByteArray::fromRawData(data.data(), data.size()), &ok);
+        parseMs = timer.elapsed();
+        if (!ok) {
+            qWarning() << "Not a tasks.json array:" << path;
+            return 1;
+        }
+        if (!write(tasks))
+            return 1;
+    } else {
+        TaskFormat::CsvColumns columns;
+        const QVector<QByteArrayView> chunks = TaskFormat::splitChunks(data, kind, chunkSize, &columns);
+        auto parse = [kind, columns](QByteArrayView chunk) {
+            return kind == TaskFormat::Csv ? TaskFormat::parseCsv(chunk, columns) : TaskFormat::parseIcs(chunk);
+        };
+
+        // Конвейер: пока пишется одна группа кусков, пул разбирает следующую
+        const int groupSize = qMax(1, QThreadPool::globalInstance()->maxThreadCount() * 4);
+        auto startGroup = [&](int from) {
+            return QtConcurrent::mapped(chunks.mid(from, groupSize), parse);
+        };
+        QFuture<QVector<Task>> pending = startGroup(0);
+        for (int from = 0; from < chunks.size(); from += groupSize) {
+            QElapsedTimer wait;
+            wait.start();
+            const QList<QVector<Task>> parts = pending.results();
+            parseMs += wait.elapsed();
+            if (from + groupSize < chunks.size())
+                pending = startGroup(from + groupSize);
+
+            QVector<Task> tasks;
+            for (const QVector<Task> &part : parts)
+                tasks.append(part);
+            if (!write(tasks))
+                return 1;
+        }
+    }
+
+    report("Импорт", rows, size, total.elapsed(), parseMs, writeMs);
+    return 0;
+}
+
+int exportTasks(DatabaseManager &db, const QString &path, TaskFormat::Kind kind, int batchSize)
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to write" << path << ":" << file.errorString();
+        return 1;
+    }
+
+    QElapsedTimer total;
+    total.start();
+    qint64 readMs = 0;
+    qint64 rows = 0;
+
+    // Порции по индексу, в памяти одновременно только одна
+    TaskFormat::begin(file, kind);
+    TaskCursor cursor(db.database(), batchSize);
+    while (!cursor.atEnd()) {
+        QElapsedTimer timer;
+        timer.start();
+        const QVector<Task> batch = cursor.fetchNext();
+        readMs += timer.elapsed();
+        TaskFormat::writeBatch(file, kind, batch, rows == 0);
+        rows += batch.size();
+    }
+    TaskFormat::end(file, kind);
+
+    if (!file.commit()) {
+        qWarning() << "Failed to commit" << path << ":" << file.errorString();
+        return 1;
+    }
+    report("Экспорт", rows, QFileInfo(path).size(), total.elapsed(), readMs, total.elapsed() - readMs);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("kurstodo-cli");
+    Trace::init();
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Массовый импорт и экспорт задач KursToDo (JSON в схеме tasks.json, CSV, ICS)");
+    parser.addHelpOption();
+    parser.addPositionalArgument("command", "import или export");
+    parser.addPositionalArgument("file", "Файл для импорта или экспорта");
+    const QCommandLineOption dbOption("db", "База данных (по умолчанию tasks_notes.db).", "path", "tasks_notes.db");
+    const QCommandLineOption formatOption("format", "json, csv или ics (по умолчанию - по расширению).", "format");
+    const QCommandLineOption batchOption("batch", "Задач на транзакцию (по умолчанию 50000).", "count", "50000");
+    const QCommandLineOption chunkOption("chunk", "Размер куска для параллельного разбора, КиБ (по умолчанию 1024).",
+                                         "kib", "1024");
+    parser.addOptions({dbOption, formatOption, batchOption, chunkOption});
+    parser.process(app);
+
+    const QStringList args = parser.positionalArguments();
+    if (args.size() != 2 || (args.at(0) != "import" && args.at(0) != "export"))
+        parser.showHelp(1);
+
+    const QString path = args.at(1);
+    const TaskFormat::Kind kind = TaskFormat::fromName(parser.isSet(formatOption) ? parser.value(formatOption) : path);
+    if (kind == TaskFormat::Unknown) {
+        qWarning() << "Unknown format for" << path;
+        return 1;
+    }
+    const int batchSize = qMax(1, parser.value(batchOption).toInt());
+    const qsizetype chunkSize = qMax<qsizetype>(64, parser.value(chunkOption).toLongLong()) * 1024;
+
+    // Одиночный процесс без читателей: кэш побольше, остальное как у приложения
+    DatabasePragmas pragmas;
+    pragmas.cacheSizeKiB = 64 * 1024;
+    DatabaseManager db;
+    if (!db.openDatabase(parser.value(dbOption), pragmas, "kurstodo-cli") || !db.createTables())
+        return 1;
+
+    if (args.at(0) == "import")
+        return importTasks(db, path, kind, batchSize, chunkSize);
+    return exportTasks(db, path, kind, batchSize);
+}
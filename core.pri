@@ -0,0 +1,44 @@
+# Хранилище и модели без QtWidgets: общие для приложения и бенчмарков
+QT       += core sql concurrent
+
+CONFIG += c++17
+
+# You can make your code fail to compile if it uses deprecated APIs.
+# In order to do so, uncomment the following line.
+#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+SOURCES += \
+    $$PWD/AsyncDatabase.cpp \
+    $$PWD/CalendarAggregates.cpp \
+    $$PWD/DatabaseManager.cpp \
+    $$PWD/DeadlineScheduler.cpp \
+    $$PWD/NoteHistory.cpp \
+    $$PWD/Recurrence.cpp \
+    $$PWD/RoaringBitmap.cpp \
+    $$PWD/StartupTimer.cpp \
+    $$PWD/TagIndex.cpp \
+    $$PWD/TaskCursor.cpp \
+    $$PWD/TaskJournal.cpp \
+    $$PWD/TaskSnapshot.cpp \
+    $$PWD/Trace.cpp
+
+HEADERS += \
+    $$PWD/AsyncDatabase.h \
+    $$PWD/CalendarAggregates.h \
+    $$PWD/DatabaseManager.h \
+    $$PWD/DeadlineScheduler.h \
+    $$PWD/Note.h \
+    $$PWD/NoteHistory.h \
+    $$PWD/Recurrence.h \
+    $$PWD/RoaringBitmap.h \
+    $$PWD/SearchHit.h \
+    $$PWD/StartupTimer.h \
+    $$PWD/TagIndex.h \
+    $$PWD/Task.h \
+    $$PWD/TaskCursor.h \
+    $$PWD/TaskJournal.h \
+    $$PWD/TaskSnapshot.h \
+    $$PWD/Trace.h
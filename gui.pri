@@ -0,0 +1,23 @@
+# Виджеты, делегаты и модели представления поверх core.pri
+include(core.pri)
+
+QT       += gui widgets
+
+SOURCES += \
+    $$PWD/MainWindow.cpp \
+    $$PWD/NoteImages.cpp \
+    $$PWD/Theme.cpp
+
+HEADERS += \
+    $$PWD/CalendarWidget.h \
+    $$PWD/MainWindow.h \
+    $$PWD/NoteDelegate.h \
+    $$PWD/NoteImages.h \
+    $$PWD/NoteModel.h \
+    $$PWD/NotesWidget.h \
+    $$PWD/SearchWidget.h \
+    $$PWD/TaskDelegate.h \
+    $$PWD/TaskFilterProxyModel.h \
+    $$PWD/TaskModel.h \
+    $$PWD/TaskWidget.h \
+    $$PWD/Theme.h
@@ -1,47 +1,40 @@
 // main.cpp
 #include <QApplication>
+#include <QFile>
 #include "MainWindow.h"
-#include "DatabaseManager.h"
+#include "AsyncDatabase.h"
+#include "StartupTimer.h"
+#include "Theme.h"
+#include "Trace.h"
 
 int main(int argc, char *argv[]) {
+    StartupTimer::start();
     QApplication app(argc, argv);
+    // KURSTODO_TRACE=trace.json - запись трассировки для chrome://tracing / Perfetto
+    Trace::init();
 
-    // Глобальный стиль приложения (тёмная тема)
-    app.setStyleSheet(R"(
-        QWidget {
-            background-color: #121212;
-            color: #ffffff;
-            font-family: 'Segoe UI', sans-serif;
-        }
-        QPushButton {
-            background-color: #2d89ef;
-            color: white;
-            border-radius: 8px;
-            padding: 10px;
-            font-size: 16px;
-        }
-        QPushButton:hover {
-            background-color: #1e5cb3;
-        }
-        QWidget#SidePanel {
-            background-color: #1e1e1e;
-        }
-        QLabel {
-            font-size: 20px;
-            color: #ffffff;
-        }
-    )");
+    // Глобальный стиль приложения (тёмная тема); виджеты своих таблиц стилей не задают
+    Theme::instance()->apply("dark");
 
-    DatabaseManager dbManager;
-    if (!dbManager.openDatabase("tasks_notes.db")) {
-        // Ошибка открытия БД
-    }
-    if (!dbManager.createTables()) {
-        // Ошибка создания таблиц
-    }
+    // База открывается на потоке писателя, окно не ждёт диска
+    AsyncDatabase database;
+    database.open("tasks_notes.db", [](DatabaseManager &db) {
+        // Однократный перенос задач из старого tasks.json в базу. Снимок
+        // tasks.json появляется только после первой компакции журнала, поэтому
+        // импорт нужен, если есть любой из трёх файлов; при ошибке файлы
+        // остаются на месте до следующего запуска
+        const QString legacy = "tasks.json";
+        if ((QFile::exists(legacy) || QFile::exists(legacy + ".log") || QFile::exists(legacy + ".log.old"))
+            && !db.importTasksFromJson(legacy))
+            qWarning() << "Failed to import tasks from" << legacy;
+    }).then(&app, [](bool) {
+        StartupTimer::mark("database opened");
+    });
 
-    MainWindow window;
+    // Страницы создаются лениво, конструктор окна дешёвый
+    MainWindow window(&database);
     window.resize(1000, 700);
     window.show();
+    StartupTimer::mark("window shown");
     return app.exec();
 }